@@ -0,0 +1,107 @@
+#ifndef ASYNCBENCH_H_
+#define ASYNCBENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "lwip/ip_addr.h"
+#include "AsyncImpair.h"
+
+// 设备上的基准测试：被测服务器与负载连接均运行在本机回环地址上（需启用CONFIG_LWIP_NETIF_LOOPBACK），
+// 每个测试阻塞运行至结束，结果以JSON格式写入json，便于在版本间比对。
+// 返回值为完整结果所需的字节数（不含结尾0），不小于len时json为空字符串（结果一般不超过1KB）。
+
+/// 负载下的接入延迟测试参数
+struct AsyncBenchLatencyConfig {
+    uint16_t    port{18000};            // 测试使用的回环端口（占用port与port+1）
+    uint8_t     bulk_clients{4};        // 持续发送数据的背景连接数
+    uint16_t    bulk_chunk{1024};       // 背景连接每次写入的字节数
+    uint16_t    work_us{200};           // 服务器处理每段接收数据的模拟耗时（微秒），使数据事件在队列中积压
+    uint16_t    probes{50};             // 每轮测量的连接次数
+    uint16_t    interval_ms{20};        // 测量连接的间隔
+};
+
+/// 接入速率测试参数
+struct AsyncBenchAcceptConfig {
+    uint16_t    port{18002};            // 测试使用的回环端口
+    uint8_t     clients{8};             // 同时发起连接的对端数，每个对端建立连接后立即关闭并重新连接
+    uint32_t    duration_ms{5000};      // 测试时长
+};
+
+/// 连接池压力测试参数
+struct AsyncBenchPoolConfig {
+    uint16_t    clients{64};            // 参与循环的连接对象数
+    uint8_t     producers{4};           // 并发归还连接的任务数，轮流固定在各核心上
+    uint32_t    duration_ms{3000};      // 压力测试时长
+};
+
+/// 连接抖动长时间运行测试参数
+struct AsyncBenchSoakConfig {
+    uint16_t    port{18004};            // 测试使用的回环端口
+    uint16_t    clients{1000};          // 对端数，即并发连接上限（回环连接两端各占一个pcb，须不超过CONFIG_LWIP_MAX_ACTIVE_TCP的一半）
+    uint16_t    connects_per_sec{200};  // 每秒发起的连接数（从空闲对端中选取）
+    uint16_t    closes_per_sec{150};    // 每秒关闭的连接数（随机选取已连接的对端）
+    uint16_t    rst_permille{200};      // 关闭时使用RST强制断开的比例（千分比），其余发送FIN
+    uint16_t    messages_per_sec{1000}; // 每秒发送的消息数（随机选取已建立的连接）
+    uint16_t    msg_min{16};            // 消息长度下限
+    uint16_t    msg_max{1024};          // 消息长度上限
+    uint32_t    duration_s{600};        // 测试时长，可设置为数小时
+    uint32_t    sample_ms{1000};        // 采样间隔，每次采样输出一行日志
+    uint32_t    heap_slack{8192};       // 结束后空闲堆允许低于开始时的字节数（协议栈缓存等残留）
+};
+
+/// 热点路径微基准测试参数
+struct AsyncBenchMicroConfig {
+    uint16_t    port{18006};            // 测试使用的回环端口
+    uint32_t    iterations{2000};       // 每项测量的次数
+    uint16_t    write_len{128};         // 发送测量每次写入的字节数
+    uint8_t     batch{4};               // 分配/回收测量每批同时存在的连接数（每个连接占用一个pcb）
+};
+
+/// 链路损伤下的传输测试用例
+struct AsyncBenchImpairCase {
+    const char*         name;
+    AsyncImpairProfile  link;
+};
+
+/// 链路损伤下的传输测试参数。回环地址与本机地址的报文不经过网卡的发送函数，无法注入损伤，
+/// 因此该测试连接局域网中的TCP回显服务器（如 socat TCP-LISTEN:7,fork,reuseaddr EXEC:cat），
+/// 损伤作用于通往该服务器的网卡的发送方向
+struct AsyncBenchImpairConfig {
+    ip_addr_t                   echo_addr{};            // 回显服务器地址（IPv4）
+    uint16_t                    echo_port{7};           //
+    const AsyncBenchImpairCase* cases{nullptr};         // 测试用例，为空时使用内置用例（无损伤、延迟、抖动、丢包、乱序、限速）
+    uint8_t                     case_count{0};          //
+    uint8_t                     flows{2};               // 吞吐量测量的并发连接数
+    uint16_t                    chunk{1024};            // 吞吐量测量每次写入的字节数
+    uint32_t                    duration_ms{5000};      // 每个用例吞吐量测量的时长
+    uint16_t                    messages{200};          // 每个用例测量往返延迟的消息数
+    uint16_t                    msg_len{64};            // 延迟测量的消息长度（不超过chunk）
+    uint16_t                    interval_ms{20};        // 延迟测量的消息间隔
+};
+
+#if CONFIG_ASYNC_TCP_BENCH
+/// @brief 测量从发起连接到服务器连接回调执行的延迟：先在空闲时测量一轮，再在背景连接持续发送数据时测量一轮
+/// @param config 测试参数，为空时使用默认参数
+extern size_t async_bench_connect_latency(const AsyncBenchLatencyConfig* config, char* json, size_t len);
+/// @brief 测量服务器每秒接入并回收的连接数，同时报告连接对象的分配数以观察连接池的复用情况
+extern size_t async_bench_accept_rate(const AsyncBenchAcceptConfig* config, char* json, size_t len);
+/// @brief 连接池测试：先测量tcpip线程中无竞争的取出/放回往返耗时，再由tcpip线程持续取出、多个任务在各核心上并发放回，
+/// 结束后检查每个连接恰好回到池中一次（结果中ok为false表示连接丢失或重复）
+extern size_t async_bench_client_pool(const AsyncBenchPoolConfig* config, char* json, size_t len);
+/// @brief 热点路径微基准测试（结果为每次操作的平均耗时，单位纳秒）：
+/// 连接分配（新建/取自连接池）与回收、事件对象从提交到清理的生命周期、add()+send()与write()（含自动合包）、IsActive()（已建立/未关联pcb的连接）、
+/// 1~16段pbuf链的接收分发，以及async_prof_dump_json()的输出耗时与长度约定
+extern size_t async_bench_micro(const AsyncBenchMicroConfig* config, char* json, size_t len);
+/// @brief 连接抖动长时间运行测试：按设定速率持续接入、关闭（FIN/RST混合）连接并发送随机长度的消息，
+/// 定期采样空闲堆、连接池、在线连接数、排队事件数与接收吞吐量。结束后关闭所有连接并检查：
+/// 连接与事件全部回收、空闲堆恢复至开始水平、各时间段的采样没有单调增长（结果中ok为false时failures列出原因）
+extern size_t async_bench_soak(const AsyncBenchSoakConfig* config, char* json, size_t len);
+#if CONFIG_ASYNC_TCP_IMPAIRMENT
+/// @brief 链路损伤下的传输测试：对每个用例在通往回显服务器的网卡上启用损伤，先由多个连接持续发送测量吞吐量
+/// （写入与回显的字节速率），再逐条发送消息测量回显往返延迟的分布（p50/p90/p99/max），并报告损伤统计
+extern size_t async_bench_impairment(const AsyncBenchImpairConfig* config, char* json, size_t len);
+#endif
+#endif
+
+#endif
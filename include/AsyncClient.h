@@ -5,7 +5,10 @@
 #include "lwip/priv/tcpip_priv.h"
 #include "my_background.h"
 #include "../src/async.h"
+#include "../src/token_bucket.h"
+#include "esp_timer.h"
 #include <atomic>
+#include <stddef.h>
 
 class AsyncServer;
 class AsyncClient;
@@ -20,21 +23,55 @@ using AcDisConnectHandler = void (*)(void* arg);
 using AcErrorHandler = void (*)(void* arg, err_t error);
 using AcTimeoutHandler = void (*)(void* arg, uint32_t time);
 using AcRecycleHandler = void (*)(void* arg);       // 回收函数
+using AcStreamProducer = size_t (*)(void* arg, void* buf, size_t len, bool* eos);    // 流式发送数据源
+
+
+/// @brief 连接回调表：同一服务器接入的连接使用相同的回调，可共享同一份只读回调表
+struct AsyncClientProfile {
+    AcConnectHandler    on_connected_handler{nullptr};       // 连接成功回调函数
+    void*               on_connected_arg{nullptr};           // 连接成功时传递给回调的参数
+    AcDisConnectHandler on_disconnected_handler{nullptr};    // 连接断开回调函数
+    void*               on_disconnected_arg{nullptr};        //
+    AcAckHandler        on_data_sent_handler{nullptr};       // 数据发送完成回调函数
+    void*               on_data_sent_arg{nullptr};           //
+    AcErrorHandler      on_error_handler{nullptr};           // 错误事件回调
+    void*               on_error_arg{nullptr};               //
+    AcDataHandler       on_data_received_handler{nullptr};   // 数据接收回调
+    void*               on_data_received_arg{nullptr};       //
+    AcTimeoutHandler    on_timeout_handler{nullptr};         // 超时事件回调
+    void*               on_timeout_arg{nullptr};             //
+    AcPollHandler       on_poll_handler{nullptr};            // 轮询事件回调
+    void*               on_poll_arg{nullptr};                //
+    AcRecycleHandler    on_recycle_handler{nullptr};         // 回收回调
+    void*               on_recycle_arg{nullptr};             //
+};
+
+/// @brief 连接候选端点
+struct AsyncEndpoint {
+    ip_addr_t   addr;
+    uint16_t    port;
+};
 
 
 class AsyncClient {
 public:
     AsyncClient();
-    ~AsyncClient();
+    virtual ~AsyncClient();
 
     bool    IsSendding();
     bool    connect(ip_addr_t& addr, uint16_t port);
+    bool    connect(const AsyncEndpoint* endpoints, size_t count, uint32_t stagger_ms = CONFIG_CONNECT_STAGGER_MS, uint32_t timeout_ms = 0);
     err_t   connect(const char* name, uint16_t port);
     void    close(bool now=false);
     size_t  get_send_buffer_size();
     size_t  add(const void* data, size_t size, uint8_t apiflags=TCP_WRITE_FLAG_MORE);
     bool    send();
     size_t  write(const void* data, uint16_t size, uint8_t apiflags=TCP_WRITE_FLAG_COPY);
+    bool    send_stream(AcStreamProducer producer, void* arg = nullptr);
+    bool    write_async(const void* data, size_t size) {
+        return write_async(nullptr, 0, data, size);
+    }
+    bool    write_async(const void* header, size_t header_len, const void* data, size_t size);
     
 
 
@@ -55,6 +92,7 @@ public:
     uint32_t    get_ack_timeout() {
         return ack_timeout_ms_;
     }
+    /// @brief 设置ACK超时：已发送的数据超过该时间仍未得到确认时触发超时回调（未设置回调时关闭连接），默认为0即不检测
     void        set_ack_timeout_ms(uint32_t timeout) {
         ack_timeout_ms_ = timeout;
     }
@@ -84,62 +122,133 @@ public:
     uint16_t    get_local_port() {
         return pcb_ ? pcb_->local_port : 0;
     }
+    /// @brief 获取接入时所经过的服务器监听端口编号（见AsyncServer::add_listener）
+    uint8_t     get_listener_id() {
+        return listener_;
+    }
     /// @brief 设置是否延迟ACK确认
     void set_defer_ack(bool defer) {
         defer_ack_ = defer;
     }
+    /// @brief 设置自动合包：write()的数据先在协议栈中累积，累积量达到阈值或超过截止时间后统一发送
+    /// @param threshold 触发发送的字节数，0表示使用当前MSS
+    /// @param deadline_us 最长累积时间（微秒），0表示使用CONFIG_ASYNC_CORK_DEADLINE_US
+    void    set_auto_cork(bool enable, uint16_t threshold = 0, uint32_t deadline_us = 0);
+    /// @brief 获取自动合包功能启用状态
+    bool    get_auto_cork_state() {
+        return auto_cork_;
+    }
+    /// @brief 设置发送限速（令牌桶），add()/write()按可用令牌截断写入量，write_async()的数据随令牌补充陆续发出
+    /// @param bytes_per_sec 每秒允许发送的字节数，0表示不限速
+    /// @param burst 允许的突发字节数，0表示使用速率的1/10（不少于TCP_MSS）
+    void    set_egress_limit(uint32_t bytes_per_sec, uint32_t burst = 0);
+    /// @brief 获取发送限速（字节/秒），0表示不限速
+    uint32_t    get_egress_limit() {
+        return egress_.rate;
+    }
+    /// @brief 获取接收窗口自动调节的目标窗口（字节），未启用CONFIG_ASYNC_RX_AUTOTUNE或尚未估算时为0
+    uint32_t    get_rx_window() {
+#if CONFIG_ASYNC_RX_AUTOTUNE
+        return rx_target_;
+#else
+        return 0;
+#endif
+    }
 
 
+    /// @brief 使用共享的回调表（回调表须在连接回收前保持有效，本连接不会修改它）
+    void    set_profile(const AsyncClientProfile* profile) {
+        profile_ = profile ? profile : &empty_profile_;
+    }
+    /// @brief 获取当前使用的回调表
+    const AsyncClientProfile* get_profile() {
+        return profile_;
+    }
     /// @brief 业务型回调，设置连接成功回调函数
     void set_connected_event_handler(AcConnectHandler cb, void* arg = nullptr) {
-        on_connected_handler = cb;
-        on_connected_arg = arg;
+        auto& profile = own_profile();
+        profile.on_connected_handler = cb;
+        profile.on_connected_arg = arg;
     }
     /// @brief 业务型回调，设置断开连接后回调函数
     void    set_disconnected_event_handler(AcDisConnectHandler cb, void* arg = nullptr) {
-        on_disconnected_handler = cb;
-        on_disconnected_arg = arg;
+        auto& profile = own_profile();
+        profile.on_disconnected_handler = cb;
+        profile.on_disconnected_arg = arg;
     }
     /// @brief 业务型回调，设置数据发送完成回调函数
     void    set_ack_event_handler(AcAckHandler cb, void* arg = nullptr) {
-        on_data_sent_handler = cb;
-        on_data_sent_arg = arg;
+        auto& profile = own_profile();
+        profile.on_data_sent_handler = cb;
+        profile.on_data_sent_arg = arg;
     }
     /// @brief 业务型回调，设置连接异常回调函数
     void    set_error_event_handler(AcErrorHandler cb, void* arg = nullptr) {
-        on_error_handler = cb;
-        on_error_arg = arg;
+        auto& profile = own_profile();
+        profile.on_error_handler = cb;
+        profile.on_error_arg = arg;
     }
     /// @brief 业务型回调，设置接收到数据包后的回调函数（不需要释放数据包，存在拷贝时延迟）
     void    set_data_received_handler(AcDataHandler cb, void* arg = nullptr) {
-        on_data_received_handler = cb;
-        on_data_received_arg = arg;
+        auto& profile = own_profile();
+        profile.on_data_received_handler = cb;
+        profile.on_data_received_arg = arg;
     }
     /// @brief 业务型回调，设置发送超时回调函数（默认关闭连接）
     void    set_timeout_event_handler(AcTimeoutHandler cb, void* arg = nullptr) {
-        on_timeout_handler = cb;
-        on_timeout_arg = arg;
+        auto& profile = own_profile();
+        profile.on_timeout_handler = cb;
+        profile.on_timeout_arg = arg;
     }
     /// @brief 业务型回调，设置定期轮询回调函数
     void    set_poll_event_handler(AcPollHandler cb, void* arg = nullptr) {
-        on_poll_handler = cb;
-        on_poll_arg = arg;
+        auto& profile = own_profile();
+        profile.on_poll_handler = cb;
+        profile.on_poll_arg = arg;
     }
 
     /// @brief 资源型回调，设置回收时的回调函数（上层对象析构时所有的资源回收都应在这里完成）
     void    set_recycle_handler(AcRecycleHandler cb, void* arg) {
-        on_recycle_handler = cb;
-        on_recycle_arg = arg;
+        auto& profile = own_profile();
+        profile.on_recycle_handler = cb;
+        profile.on_recycle_arg = arg;
     }
 
+protected:
+    /// 按回调策略生成的lwIP回调入口
+    struct client_ops_t {
+        void                (*install)(AsyncClient* self);  // 向pcb注册回调
+        tcp_connected_fn    connected;                      // 主动连接成功回调
+        void                (*recycle)(AsyncClient* self);  // 尝试回收连接
+        void                (*error)(AsyncClient* self, err_t err);     // 报告连接错误
+    };
+
+    explicit AsyncClient(const client_ops_t* ops);
+    template <class Policy> static const client_ops_t* Ops();
+
 private:
     friend class AsyncServer;
-    
+    friend class AsyncClientPool;
+#if CONFIG_ASYNC_TCP_BENCH
+    friend struct AsyncBenchAccess;     // 微基准测试直接测量内部路径
+#endif
+    struct Layout;
+    struct ProfilePolicy;
+    struct connect_race_t;
+
+    // 连接状态（event_group_中的事件位）
+    static constexpr EventBits_t ASYNC_TCP_ACTIVE_BIT   = BIT0;     // 活跃状态
+    static constexpr EventBits_t ASYNC_TCP_SENDDING_BIT = BIT1;     // 正在发送
+    static constexpr EventBits_t ASYNC_TCP_CAN_SEND_BIT = BIT2;     // 可以发送
+
     struct async_event_t {
       void*         arg;
       union {
         err_t       err;
-        uint32_t    poll_time;
+        struct {
+          uint32_t  poll_time;
+          uint32_t  ack_wait;   // 未确认数据已等待的时间，0表示未超时
+        };
         struct {
           uint16_t  tot_len{0};
           pbuf*     buf;
@@ -151,9 +260,29 @@ private:
       };
     };
 
+    /// 异步发送数据块，数据紧随其后存放
+    struct async_tx_t {
+      async_tx_t*   next;
+      size_t        len;
+      size_t        offset;
+    };
+
+    /// 流式发送状态，与暂存区（1个MSS）一次申请，暂存区紧随其后
+    struct stream_t {
+      AcStreamProducer  producer;   // 数据源
+      void*             arg;        //
+      uint16_t          buf_len;    // 暂存区长度
+      uint16_t          fill;       // 暂存区中尚未写入协议栈的字节数
+      bool              eos;        // 数据源是否已报告结束
+      uint8_t* buf() {
+          return reinterpret_cast<uint8_t*>(this + 1);
+      }
+    };
+
     struct lwip_data_t {
       tcpip_api_call_data   data;
       tcp_pcb*              pcb;
+      AsyncClient*          client;
       union {
         struct {
           uint16_t          port;
@@ -165,53 +294,175 @@ private:
           uint16_t      write_len;
           const void*   write_data;
         };
+        struct {
+          uint32_t      egress_rate;
+          uint32_t      egress_burst;
+        };
+        stream_t*       stream;
+        struct {
+          uint16_t      ack_len;
+        };
+        struct {
+          bool          cork_enable;
+          uint16_t      cork_threshold;
+          uint32_t      cork_deadline_us;
+        };
       };
     };
 
-    void init(AsyncServer* server, tcp_pcb* pcb);
+    void init(AsyncServer* server, tcp_pcb* pcb, const AsyncClientProfile* profile);
     void initClient();
     bool IsActive();
-    void recycle();
-    void HandleReceiveEvent(pbuf* pb);
-    void HandleFinEvent();
-    void HandleErrorEvent(err_t err);
-    void HandlePollEvent();
-    void HandleConnectEvent();
-    void HandleSentEvent(uint16_t len);
+    void Release();
+    /// @brief 断开/错误事件的优先级：本连接仍有排队的事件时使用数据优先级排在其后，保证断开与错误回调晚于最后一次数据回调
+    AsyncPriority TeardownPriority() {
+        return events_.load() ? AsyncPriority::Data : AsyncPriority::Control;
+    }
+    template <class Policy> static void InstallCallbacks(AsyncClient* self);
+    template <class Policy> static err_t ConnectedCallback(void* arg, tcp_pcb* pcb, err_t err);
+    template <class Policy> void recycle();
+    template <class Policy> void HandleReceiveEvent(pbuf* pb);
+    template <class Policy> void HandleFinEvent();
+    template <class Policy> void HandleErrorEvent(err_t err);
+    template <class Policy> void HandlePollEvent();
+    template <class Policy> void HandleConnectEvent();
+    template <class Policy> void HandleSentEvent(uint16_t len);
+    void FlushCork();
+    void ShutdownWhenDrained();
+    void PumpStream();
+    void EndStream();
+    AsyncClientProfile& own_profile();
+    bool HasPendingTx();
+    void DrainTx();
+    void DropTx();
+    uint32_t EgressRoom();
+    uint16_t EgressAllow(uint16_t len);
+    size_t TransmitTx(size_t limit);
+    void CancelEgress();
+    static void EgressTimer(void* arg);
+    void CancelConnect();
+    static err_t RaceCancel(AsyncClient* self);
+    static bool RaceLaunch(connect_race_t* race);
+    static void RaceFinish(connect_race_t* race, tcp_pcb* winner, err_t err);
+    static void RaceStagger(void* arg);
+    static void RaceDeadline(void* arg);
+    void AckRx(uint16_t len);
+#if CONFIG_ASYNC_RX_AUTOTUNE
+    uint32_t RxRtt();
+    void RxRetune(uint16_t mss, uint32_t rtt);
+    void RxRelease();
+    void RxSampleRtt(uint32_t sample) {
+        sample = sample ? sample : 1;
+        rx_srtt_ms_ = rx_srtt_ms_ ? (rx_srtt_ms_ * 7 + sample) / 8 : sample;
+    }
+#endif
 
 
+    // 热数据：事件路径上每次都会访问，集中放在首个缓存行
+    tcp_pcb*            pcb_{nullptr};          // 关联的协议控制块
+    EventGroupHandle_t  event_group_{nullptr};
+    const AsyncClientProfile*   profile_{&empty_profile_};    // 当前使用的回调表
     std::atomic<size_t> events_{0};             // 关联的事件数据是多少
-    size_t              unack_rx_bytes_{0};     // 尚未确认字节数
     uint32_t            last_rx_timestamp_;     // 最后接收数据时间戳
     uint32_t            last_tx_timestamp_;     // 最后发送数据时间戳
-    uint32_t            ack_timeout_ms_;        // ACK超时时间（毫秒）
-    uint16_t            rx_timeout_second_{0};  // 接收超时时间（秒）
+    size_t              unack_rx_bytes_{0};     // 尚未确认字节数
+    std::atomic<bool>   poll_pending_{false};   // 是否存在尚未处理的轮询事件
     bool                nodelay_{false};
     bool                defer_ack_{false};      // 是否延迟发送ACK
-    tcp_pcb*            pcb_{nullptr};          // 关联的协议控制块
+    std::atomic<bool>   auto_cork_{false};      // 是否自动合包（在tcpip线程中修改）
+    uint16_t            rx_timeout_second_{0};  // 接收超时时间（秒）
+
+    // 冷数据
+    uint32_t            ack_timeout_ms_;        // ACK超时时间（毫秒）
+    uint32_t            ack_wait_start_{0};     // 开始等待确认的时间，0表示没有未确认的数据（仅在tcpip线程访问）
+    uint32_t            cork_deadline_us_{0};   // 合包最长等待时间（微秒，仅在tcpip线程访问）
+    uint16_t            cork_threshold_{0};     // 合包发送阈值，0表示MSS（仅在tcpip线程访问）
+    uint8_t             listener_{0};           // 接入的监听端口编号
+    std::atomic<bool>   connecting_{false};     // 是否正在主动连接
+    std::atomic<bool>   tx_drain_pending_{false};   // 是否已通知tcpip线程处理异步发送
+    bool                egress_timer_armed_{false}; // 是否已等待令牌补充
+    bool                in_tx_ring_{false};     // 是否在服务器发送调度环中
+    bool                closing_{false};        // 服务器优雅关闭中：数据发完后发送FIN（仅在tcpip线程访问）
+    size_t              corked_bytes_{0};       // 已写入但尚未输出的字节数（仅在tcpip线程访问）
+    esp_timer_handle_t  cork_timer_{nullptr};   // 合包截止定时器
+    stream_t*           stream_{nullptr};       // 进行中的流式发送（仅在tcpip线程访问）
+    std::atomic<async_tx_t*>    tx_inbox_{nullptr};     // 异步发送提交队列（多生产者，后进先出），为&tx_closed_时表示已关闭
+    std::atomic<uint32_t>       tx_queued_{0};          // 已提交但尚未写入协议栈的异步数据字节数
+    async_tx_t*         tx_head_{nullptr};      // 待写入协议栈的异步数据（仅在tcpip线程访问）
+    async_tx_t*         tx_tail_{nullptr};      //
+    token_bucket_t      egress_;                // 发送限速（仅在tcpip线程修改）
+    uint32_t            deficit_{0};            // 差额轮询的剩余额度
+    AsyncClient*        tx_ring_next_{nullptr}; // 服务器发送调度环（仅在tcpip线程访问）
+#if CONFIG_ASYNC_RX_AUTOTUNE
+    uint32_t            rx_target_{0};          // 目标接收窗口，0表示尚未估算（以下仅在tcpip线程访问）
+    uint32_t            rx_withheld_{0};        // 已处理但暂不归还的字节数
+    uint32_t            rx_rate_{0};            // 平滑后的处理速度（字节/秒）
+    uint32_t            rx_srtt_ms_{0};         // 接收方向平滑后的往返时间，0表示尚无样本
+    uint32_t            rx_probe_start_{0};     // 接收窗口从不足一个MSS打开的时间，0表示未在测量
+    uint32_t            rx_sample_bytes_{0};    // 当前采样周期内处理的字节数
+    uint32_t            rx_sample_start_{0};    // 当前采样周期起始时间
+#endif
+    const client_ops_t* ops_;                   // 回调策略对应的lwIP回调入口
+    connect_race_t*     race_{nullptr};         // 进行中的主动连接（仅在tcpip线程访问）
     AsyncServer*        server_{nullptr};
+    AsyncClient*        live_prev_{nullptr};    // 服务器在线连接表
+    AsyncClient*        live_next_{nullptr};    //
     AsyncClient*        next_{nullptr};
-    EventGroupHandle_t  event_group_{nullptr};
-    MyBackground&       bg_;
+    AsyncClientProfile* own_profile_{nullptr};  // 本连接单独设置回调时使用的回调表（首次设置时创建，回收后复用）
 
-    AcConnectHandler    on_connected_handler{nullptr};       // 连接成功回调函数
-    void*               on_connected_arg{nullptr};           // 连接成功时传递给回调的参数
-    AcDisConnectHandler on_disconnected_handler{nullptr};    // 连接断开回调函数
-    void*               on_disconnected_arg{nullptr};        //
-    AcAckHandler        on_data_sent_handler{nullptr};       // 数据发送完成回调函数
-    void*               on_data_sent_arg{nullptr};           //
-    AcErrorHandler      on_error_handler{nullptr};           // 错误事件回调
-    void*               on_error_arg{nullptr};               //
-    AcDataHandler       on_data_received_handler{nullptr};   // 数据接收回调
-    void*               on_data_received_arg{nullptr};       //
-    AcTimeoutHandler    on_timeout_handler{nullptr};         // 超时事件回调
-    void*               on_timeout_arg{nullptr};             //
-    AcPollHandler       on_poll_handler{nullptr};            // 轮询事件回调
-    void*               on_poll_arg{nullptr};                //
-    
-    AcRecycleHandler    on_recycle_handler;
-    void*               on_recycle_arg;     
+    static const AsyncClientProfile empty_profile_;
+    static async_tx_t   tx_closed_;                 // 异步发送队列的关闭标记
+};
+
+#define ASYNC_CACHE_LINE            64      // 热数据所在的首个缓存行
+
+// 32位目标上单个连接对象的内存预算（字节），从基线布局出发逐项登记新增字段。
+// 基线布局为108字节，其中8组回调与参数占64字节，已移入共享的AsyncClientProfile，其余44字节的字段保留。
+#define ASYNC_CLIENT_SIZE_BASE      44      // 虚表指针、pcb_、event_group_、events_、时间戳、unack_rx_bytes_、标志与超时、server_、next_
+#define ASYNC_CLIENT_SIZE_PROFILE   8       // profile_、own_profile_：替代基线中的回调与参数
+#define ASYNC_CLIENT_SIZE_HOT_FLAGS 4       // poll_pending_、auto_cork_：轮询事件合并与自动合包的标志，位于热数据行
+#define ASYNC_CLIENT_SIZE_ACK       4       // ack_wait_start_：ACK超时的计时起点
+#define ASYNC_CLIENT_SIZE_CORK      14      // cork_deadline_us_、cork_threshold_、corked_bytes_、cork_timer_：自动合包
+#define ASYNC_CLIENT_SIZE_FLAGS     6       // listener_及各单字节标志，与cork_threshold_共用一个8字节槽
+#define ASYNC_CLIENT_SIZE_STREAM    4       // stream_：流式发送状态按需申请，连接中只保留指针
+#define ASYNC_CLIENT_SIZE_TX        16      // tx_inbox_、tx_queued_、tx_head_、tx_tail_：异步发送队列
+#define ASYNC_CLIENT_SIZE_EGRESS    24      // egress_、deficit_、tx_ring_next_：发送限速与服务器发送调度环
+#define ASYNC_CLIENT_SIZE_CONNECT   8       // ops_、race_：回调策略入口与多端点连接竞速
+#define ASYNC_CLIENT_SIZE_LIVE      8       // live_prev_、live_next_：服务器在线连接表
+#if CONFIG_ASYNC_RX_AUTOTUNE
+#define ASYNC_CLIENT_SIZE_AUTOTUNE  28      // rx_target_等7个字段：接收窗口自动调节
+#else
+#define ASYNC_CLIENT_SIZE_AUTOTUNE  0       //
+#endif
+#define ASYNC_CLIENT_SIZE_BUDGET    (ASYNC_CLIENT_SIZE_BASE + ASYNC_CLIENT_SIZE_PROFILE + ASYNC_CLIENT_SIZE_HOT_FLAGS \
+    + ASYNC_CLIENT_SIZE_ACK + ASYNC_CLIENT_SIZE_CORK + ASYNC_CLIENT_SIZE_FLAGS + ASYNC_CLIENT_SIZE_STREAM \
+    + ASYNC_CLIENT_SIZE_TX + ASYNC_CLIENT_SIZE_EGRESS + ASYNC_CLIENT_SIZE_CONNECT + ASYNC_CLIENT_SIZE_LIVE \
+    + ASYNC_CLIENT_SIZE_AUTOTUNE)
+
+/// 连接对象的内存布局检查：事件路径上的热数据须位于首个缓存行内，单个连接的内存占用不超过预算。
+/// 新增字段须先尝试放入已有的填充或按需申请的结构中，确需常驻时在上方预算中单独登记并说明用途。
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+struct AsyncClient::Layout {
+#define ASYNC_CLIENT_HOT(field) \
+    static_assert(offsetof(AsyncClient, field) + sizeof(AsyncClient::field) <= ASYNC_CACHE_LINE, #field "须位于首个缓存行")
+    ASYNC_CLIENT_HOT(pcb_);
+    ASYNC_CLIENT_HOT(event_group_);
+    ASYNC_CLIENT_HOT(profile_);
+    ASYNC_CLIENT_HOT(events_);
+    ASYNC_CLIENT_HOT(last_rx_timestamp_);
+    ASYNC_CLIENT_HOT(last_tx_timestamp_);
+    ASYNC_CLIENT_HOT(unack_rx_bytes_);
+    ASYNC_CLIENT_HOT(poll_pending_);
+    ASYNC_CLIENT_HOT(nodelay_);
+    ASYNC_CLIENT_HOT(defer_ack_);
+    ASYNC_CLIENT_HOT(auto_cork_);
+    ASYNC_CLIENT_HOT(rx_timeout_second_);
+#undef ASYNC_CLIENT_HOT
+    static_assert(offsetof(AsyncClient, rx_timeout_second_) < offsetof(AsyncClient, ack_timeout_ms_), "热数据须位于冷数据之前");
+    static_assert(sizeof(void*) != 4 || sizeof(AsyncClient) <= ASYNC_CLIENT_SIZE_BUDGET, "单个连接的内存占用超出预算");
 };
+#pragma GCC diagnostic pop
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef ASYNCIMPAIR_H_
+#define ASYNCIMPAIR_H_
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "lwip/err.h"
+
+struct netif;
+
+/// 链路损伤参数：在网卡发送方向注入延迟、抖动、丢包、乱序与带宽限制，用于在真实设备上评估弱网下的收发表现
+struct AsyncImpairProfile {
+    uint32_t    delay_ms{0};            // 固定延迟
+    uint32_t    jitter_ms{0};           // 随机抖动，在固定延迟基础上增加 0~jitter_ms
+    uint16_t    loss_permille{0};       // 丢包率（千分比）
+    uint16_t    reorder_permille{0};    // 乱序率（千分比），选中的报文额外延迟reorder_ms
+    uint32_t    reorder_ms{0};          //
+    uint32_t    rate_bytes_per_sec{0};  // 带宽上限，0表示不限制
+    uint32_t    queue_ms{1000};         // 带宽受限时的最大排队时间，超过后丢弃（尾部丢弃）
+};
+
+/// 链路损伤统计
+struct AsyncImpairStats {
+    uint32_t    passed;     // 直接发出的报文数
+    uint32_t    delayed;    // 延迟后发出的报文数
+    uint32_t    reordered;  // 被选中乱序的报文数
+    uint32_t    dropped;    // 随机丢弃的报文数
+    uint32_t    overflow;   // 排队超时丢弃的报文数
+};
+
+#if CONFIG_ASYNC_TCP_IMPAIRMENT
+/// @brief 在指定网卡上启用链路损伤（同一时间仅支持一个网卡），再次调用时更新参数
+extern err_t async_impair_attach(struct netif* netif, const AsyncImpairProfile* profile);
+/// @brief 停止链路损伤，已延迟的报文仍会按时发出
+extern void async_impair_detach();
+/// @brief 获取统计
+extern AsyncImpairStats async_impair_stats();
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef ASYNCMUX_H_
+#define ASYNCMUX_H_
+
+#include "AsyncClient.h"
+#include <atomic>
+
+class AsyncMux;
+
+using AcMuxOpenHandler = bool (*)(void* arg, AsyncMux* mux, uint8_t channel);    // 对端打开通道，返回false时拒绝
+using AcMuxCreditHandler = void (*)(void* arg, size_t credit);                  // 对端归还发送额度，参数为当前可发送字节数
+
+
+/// @brief 在单个TCP连接上复用多个逻辑通道。
+/// 数据以帧的形式发送：[类型:1][通道:1][负载长度:2，大端] + 负载；
+/// 每个通道有独立的发送额度（初始为CONFIG_ASYNC_MUX_WINDOW），接收方处理完数据后归还额度，
+/// 单个通道处理缓慢时只阻塞该通道，不影响同一连接上的其他通道。
+/// 复用层接管连接的数据接收、断开与错误回调，须在连接回收前析构；
+/// 仅适用于使用回调表的AsyncClient（BasicAsyncClient请在Handler中调用feed()）。
+class AsyncMux {
+public:
+    /// @param initiator 主动连接一方为true，使用奇数通道号；接入一方使用偶数通道号，避免双方同时打开同一通道
+    AsyncMux(AsyncClient* client, bool initiator);
+    ~AsyncMux();
+
+    int     open();
+    bool    close(uint8_t channel);
+    size_t  write(uint8_t channel, const void* data, size_t len);
+    void    feed(const void* data, size_t len);
+
+    /// @brief 获取承载的TCP连接
+    AsyncClient*    get_client() {
+        return client_;
+    }
+    /// @brief 通道是否处于打开状态
+    bool    is_open(uint8_t channel) {
+        return valid(channel) && channels_[channel].open.load();
+    }
+    /// @brief 获取通道当前可发送的字节数
+    size_t  get_credit(uint8_t channel) {
+        return is_open(channel) ? channels_[channel].tx_credit.load() : 0;
+    }
+
+    /// @brief 设置对端打开通道时的回调函数（未设置时拒绝对端打开的通道）
+    void    set_open_handler(AcMuxOpenHandler cb, void* arg = nullptr) {
+        on_open_handler_ = cb;
+        on_open_arg_ = arg;
+    }
+    /// @brief 设置通道接收到数据后的回调函数（回调返回后即归还额度）
+    void    set_channel_data_handler(uint8_t channel, AcDataHandler cb, void* arg = nullptr) {
+        if (valid(channel)) {
+            channels_[channel].on_data_handler = cb;
+            channels_[channel].on_data_arg = arg;
+        }
+    }
+    /// @brief 设置通道被对端关闭或连接断开后的回调函数
+    void    set_channel_close_handler(uint8_t channel, AcDisConnectHandler cb, void* arg = nullptr) {
+        if (valid(channel)) {
+            channels_[channel].on_close_handler = cb;
+            channels_[channel].on_close_arg = arg;
+        }
+    }
+    /// @brief 设置对端归还发送额度后的回调函数
+    void    set_channel_credit_handler(uint8_t channel, AcMuxCreditHandler cb, void* arg = nullptr) {
+        if (valid(channel)) {
+            channels_[channel].on_credit_handler = cb;
+            channels_[channel].on_credit_arg = arg;
+        }
+    }
+
+private:
+    enum frame_type_t : uint8_t {
+        FRAME_OPEN = 0,
+        FRAME_DATA,
+        FRAME_CLOSE,
+        FRAME_CREDIT,
+    };
+    static constexpr size_t FRAME_HEADER_LEN = 4;
+
+    /// @brief 通道号是否在范围内（通道数可为256，参数不使用uint8_t以免比较恒成立）
+    static constexpr bool valid(unsigned channel) {
+        return channel < CONFIG_ASYNC_MUX_MAX_CHANNELS;
+    }
+
+    struct channel_t {
+        std::atomic<bool>       open{false};
+        std::atomic<uint32_t>   tx_credit{0};           // 可发送字节数
+        uint32_t                rx_consumed{0};         // 已处理但尚未归还的额度（仅在接收任务访问）
+        AcDataHandler           on_data_handler{nullptr};
+        void*                   on_data_arg{nullptr};       //
+        AcDisConnectHandler     on_close_handler{nullptr};
+        void*                   on_close_arg{nullptr};      //
+        AcMuxCreditHandler      on_credit_handler{nullptr};
+        void*                   on_credit_arg{nullptr};     //
+    };
+
+    bool SendFrame(uint8_t type, uint8_t channel, const void* data, size_t len);
+    void Dispatch(uint8_t type, uint8_t channel, const uint8_t* payload, uint16_t len);
+    void Reset(uint8_t channel);
+    void CloseAll();
+
+    AsyncClient*        client_;
+    bool                initiator_;
+    channel_t           channels_[CONFIG_ASYNC_MUX_MAX_CHANNELS];   // 0号通道保留
+    uint8_t             rx_header_[FRAME_HEADER_LEN];   // 帧重组（仅在接收任务访问）
+    uint8_t             rx_header_len_{0};              //
+    uint16_t            rx_len_{0};                     //
+    uint16_t            rx_got_{0};                     //
+    uint8_t*            rx_buf_{nullptr};               // 跨数据包的帧负载暂存区
+    AcMuxOpenHandler    on_open_handler_{nullptr};
+    void*               on_open_arg_{nullptr};
+};
+
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef ASYNCPROFILE_H_
+#define ASYNCPROFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/// 热点路径编号（Add/Send/Write/Recycle只统计tcpip线程中的处理，不含调用方等待tcpip线程的时间）
+enum class AsyncProf : uint8_t {
+    Allocate = 0,   // AsyncServer::allocateClient
+    Recycle,        // 连接回收时释放pcb与发送队列
+    Schedule,       // async_schedule 提交事件
+    EventRun,       // 事件处理函数 + 清理函数
+    Add,            // AsyncClient::add 写入协议栈
+    Send,           // AsyncClient::send 输出
+    Write,          // AsyncClient::write 自动合包时的写入（未合包时计入Add与Send）
+    Count,
+};
+
+#define ASYNC_PROF_MAX_CHAIN    16      // 接收分发按pbuf链长度统计的上限
+
+#if CONFIG_ASYNC_TCP_PROFILING
+#include "esp_cpu.h"
+
+extern void async_prof_record(AsyncProf path, uint32_t cycles);
+extern void async_prof_record_chain(size_t segments, uint32_t cycles);
+extern void async_prof_discard();
+
+/// 周期计时：周期计数器由各核心独立计数，计时期间任务被迁移到其他核心时样本无效
+struct async_prof_timer_t {
+    int         core{esp_cpu_get_core_id()};
+    uint32_t    start{esp_cpu_get_cycle_count()};
+
+    /// @brief 获取经过的周期数
+    /// @return 任务已迁移到其他核心时返回false（并计入丢弃的样本数）
+    bool elapsed(uint32_t* cycles) const {
+        auto end = esp_cpu_get_cycle_count();
+        if (esp_cpu_get_core_id() != core) {
+            async_prof_discard();
+            return false;
+        }
+        *cycles = end - start;
+        return true;
+    }
+};
+
+/// 在作用域结束时记录耗时
+struct async_prof_scope_t {
+    AsyncProf           path;
+    async_prof_timer_t  timer;
+    ~async_prof_scope_t() {
+        uint32_t cycles;
+        if (timer.elapsed(&cycles)) {
+            async_prof_record(path, cycles);
+        }
+    }
+};
+
+#define ASYNC_PROF_SCOPE(path)  async_prof_scope_t async_prof_scope_##path{AsyncProf::path, {}}
+#else
+#define ASYNC_PROF_SCOPE(path)
+#endif
+
+/// @brief 以JSON格式输出热点路径统计（CONFIG_ASYNC_TCP_PROFILING 未启用时输出空对象）
+/// @return 完整输出所需的字节数（不含结尾0），不小于len时buf为空字符串，不会输出不完整的JSON
+extern size_t async_prof_dump_json(char* buf, size_t len);
+/// @brief 清空统计
+extern void async_prof_reset();
+
+#endif
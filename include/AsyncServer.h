@@ -8,9 +8,30 @@
 #include "lwip/priv/tcpip_priv.h"
 #include "AsyncClient.h"
 #include "../src/async.h"
+#include "../src/client_pool.h"
 
 
 using AcCleanHandler = void (*)(void* arg);       // 清理函数
+using AcShutdownHandler = void (*)(void* arg);    // 关闭完成函数
+using AcClientFactory = AsyncClient* (*)();       // 连接创建函数
+
+/// 服务器运行统计，用于长时间运行时观察连接与事件是否持续增长
+struct AsyncServerStats {
+    size_t      live;           // 在线连接数
+    size_t      pooled;         // 连接池中的空闲连接数
+    size_t      allocated;      // 当前存在的连接对象数（在线 + 空闲 + 等待回收）
+    size_t      pending_events; // 排队等待处理的事件数（所有连接）
+    uint32_t    accepted;       // 累计接入连接数
+    uint32_t    rejected;       // 累计拒绝连接数
+    uint32_t    recycled;       // 累计回收连接数
+};
+
+/// 服务器关闭方式
+enum class AsyncShutdownMode : uint8_t {
+    ListenOnly,     // 仅停止监听，已建立的连接继续运行
+    Graceful,       // 发出待发送数据后断开（FIN），超过截止时间仍未断开的连接强制断开
+    Immediate,      // 立即强制断开（RST）
+};
 
 
 class AsyncClient;
@@ -21,49 +42,109 @@ public:
     AsyncServer(uint16_t port) : AsyncServer(IPADDR4_INIT(0), port) {}
     ~AsyncServer() {
         end();
+        set_egress_budget(0);
+        if (shutdownTimer_) {
+            xTimerDelete(shutdownTimer_, 0);
+        }
         if (recycleTimer_) {
             xTimerDelete(recycleTimer_, 0);
             Clean(true);
         }
     }
 
+    int  add_listener(ip_addr_t addr, uint16_t port, const AsyncClientProfile* profile = nullptr, uint16_t max_clients = 0);
     void begin();
     void end();
-    AsyncClient* allocateClient(tcp_pcb* pcb);
+    void end(AsyncShutdownMode mode, uint32_t deadline_ms = 0, AcShutdownHandler on_done = nullptr, void* arg = nullptr);
+    AsyncClient* allocateClient(tcp_pcb* pcb, uint8_t listener = 0);
     /// @brief 回收TCP连接
     void recycleClient(AsyncClient* c) {
-        AsyncClient* expected;
-        do {
-            expected = pool_.load();
-            c->next_ = expected;
-        } while (!pool_.compare_exchange_weak(expected, c));
+        pool_.push(c);
+    }
+    /// @brief 获取所有监听端口当前的连接总数
+    size_t get_live_count() {
+        return live_count_.load();
     }
+    /// @brief 获取服务器运行统计
+    AsyncServerStats get_stats() {
+        return AsyncServerStats{
+            .live = live_count_.load(),
+            .pooled = pool_.size(),
+            .allocated = allocated_.load(),
+            .pending_events = async_pending(),
+            .accepted = accepted_.load(),
+            .rejected = rejected_.load(),
+            .recycled = recycled_.load(),
+        };
+    }
+    /// @brief 设置服务器总发送带宽，各连接通过write_async()排队的数据按差额轮询公平分配，
+    /// add()/write()/send_stream()直接写入的数据同样受总带宽约束：不超过剩余带宽，且有其他连接排队时每次最多写入一个额度（返回实际写入量）
+    /// @param bytes_per_sec 每秒允许发送的总字节数，0表示不限制（各连接自行发送）
+    /// @param quantum 每轮分配给每个连接的字节数，0表示使用TCP_MSS
+    void set_egress_budget(uint32_t bytes_per_sec, uint16_t quantum = 0);
     /// @brief 设置建立连接的客户端默认是否采取延迟改善策略
     void set_nodelay(bool nodelay) {
         nodelay_ = nodelay;
     }
     
-    /// @brief 获取当前服务器连接状态
-    tcp_state get_connection_state() {
-        return pcb_ ? pcb_->state : CLOSED;
+    /// @brief 获取指定监听端口的连接状态
+    tcp_state get_connection_state(uint8_t listener = 0) {
+        if (listener >= listener_count_ || listeners_[listener].pcb == nullptr) {
+            return CLOSED;
+        }
+        return listeners_[listener].pcb->state;
+    }
+    /// @brief 获取指定监听端口当前的连接数
+    uint16_t get_client_count(uint8_t listener = 0) {
+        return listener < listener_count_ ? listeners_[listener].clients.load() : 0;
     }
     /// @brief 设置客户端连接成功时的回调函数及参数
     void set_connected_handler(AcConnectHandler handler, void* arg) {
         on_connected_handler_ = handler;
         on_connected_arg_ = arg;
     }
+    /// @brief 设置接入连接默认使用的回调表（所有连接共享，须在服务器运行期间保持有效）
+    void set_client_profile(const AsyncClientProfile* profile) {
+        client_profile_ = profile;
+    }
     /// @brief 设置连接清理时，上层的清理逻辑
     void set_clean_handler(AcCleanHandler handler, void* arg) {
         on_clean_handler_ = handler;
         on_clean_arg_ = arg;
     }
 
+protected:
+    /// @brief 设置连接池为空时创建连接的方式（派生服务器用于创建派生连接类型）
+    void set_client_factory(AcClientFactory factory) {
+        client_factory_ = factory;
+    }
+
 private:
+    friend class AsyncClient;
+
     struct tcpip_listen_data_t {
         tcpip_api_call_data*    data;
         tcp_pcb*                pcb;
         uint8_t                 listen_backlog;
     };
+    struct tcpip_clean_data_t {
+        tcpip_api_call_data*    data;
+        AsyncClientPool*        pool;
+        AsyncClient*            list;
+    };
+    struct tcpip_teardown_data_t {
+        tcpip_api_call_data*    data;
+        AsyncServer*            server;
+        bool                    abort;
+        bool                    first;      // 是否为本次关闭的第一批（从在线表头开始）
+        bool                    more;       // 在线表中是否仍有未处理的连接
+    };
+    struct tcpip_egress_data_t {
+        tcpip_api_call_data*    data;
+        AsyncServer*            server;
+        uint32_t                rate;
+        uint16_t                quantum;
+    };
     struct tcpip_bind_data_t {
         tcpip_api_call_data*    data;
         tcp_pcb*                pcb;
@@ -71,17 +152,60 @@ private:
         uint16_t                port;
     };
 
+    /// 监听端口：接入的连接记录其来源，并使用该端口的回调表与连接数限制
+    struct listener_t {
+        AsyncServer*                server;
+        uint8_t                     id;
+        tcp_pcb*                    pcb;
+        ip_addr_t                   addr;
+        uint16_t                    port;
+        uint16_t                    max_clients;    // 最大连接数，0表示不限制
+        std::atomic<uint16_t>       clients;        // 当前连接数
+        const AsyncClientProfile*   profile;        // 该端口的回调表，为空时使用服务器默认回调表
+    };
+
     void Clean(bool clean_all=false);
-    err_t bind();
+    err_t bind(listener_t& listener);
+    void listen(listener_t& listener);
+    void releaseClient(AsyncClient* c);
+    AsyncClient* newClient() {
+        allocated_++;
+        return client_factory_ ? client_factory_() : new AsyncClient();
+    }
+    void trackClient(AsyncClient* c);
+    void untrackClient(AsyncClient* c);
+    void Teardown(bool abort);
+    bool TeardownBatch(bool abort, bool first);
+    void EnqueueEgress(AsyncClient* c);
+    void RemoveEgress(AsyncClient* c);
+    void ScheduleEgress();
+    static void EgressTimer(void* arg);
 
     bool                nodelay_{false};
-    uint16_t            port_;
-    ip_addr_t           addr_;
-    tcp_pcb*            pcb_{nullptr};
-    std::atomic<AsyncClient*>   pool_{nullptr};
+    listener_t          listeners_[CONFIG_SERVER_MAX_LISTENERS];
+    uint8_t             listener_count_{0};
+    AsyncClientPool             pool_;
     TimerHandle_t               recycleTimer_{nullptr};
-    MyBackground&	            bg_;
+    TimerHandle_t               shutdownTimer_{nullptr};    // 优雅关闭截止定时器
+    AsyncClient*                live_{nullptr};             // 在线连接表
+    std::atomic<size_t>         live_count_{0};             //
+    portMUX_TYPE                live_lock_ = portMUX_INITIALIZER_UNLOCKED;
+    AsyncClient*                teardown_cursor_[2]{};      // 优雅/强制关闭下一批的起点（受live_lock_保护）
+    std::atomic<bool>           shutting_down_{false};      // 是否正在等待所有连接关闭
+    std::atomic<size_t>         allocated_{0};              // 运行统计
+    std::atomic<uint32_t>       accepted_{0};               //
+    std::atomic<uint32_t>       rejected_{0};               //
+    std::atomic<uint32_t>       recycled_{0};               //
+    token_bucket_t              egress_;                    // 总发送带宽（仅在tcpip线程修改）
+    uint16_t                    egress_quantum_{TCP_MSS};   // 差额轮询每轮额度
+    bool                        egress_timer_armed_{false}; // 是否已等待令牌补充
+    AsyncClient*                tx_ring_{nullptr};          // 发送调度环，指向最近服务的连接（仅在tcpip线程访问）
+    size_t                      tx_ring_size_{0};           //
+    AcShutdownHandler           on_shutdown_handler_{nullptr};
+    void*                       on_shutdown_arg_{nullptr};
 
+    const AsyncClientProfile*   client_profile_{nullptr};
+    AcClientFactory             client_factory_{nullptr};
     AcConnectHandler    on_connected_handler_{nullptr};
     void*               on_connected_arg_{nullptr};
     AcCleanHandler      on_clean_handler_{nullptr};
@@ -0,0 +1,135 @@
+#ifndef BASICASYNCCLIENT_H_
+#define BASICASYNCCLIENT_H_
+
+#include "AsyncClient.h"
+#include "detail/client_events.h"
+#include <type_traits>
+#include <utility>
+
+template <class Handler> class BasicAsyncClient;
+
+// 检测 Handler 是否提供指定事件的成员函数
+#define ASYNC_HANDLER_DETECT(name, ...)                                                         \
+    template <class H, class C, class = void>                                                   \
+    struct has_##name##_t : std::false_type {};                                                 \
+    template <class H, class C>                                                                 \
+    struct has_##name##_t<H, C, std::void_t<decltype(                                           \
+        std::declval<H&>().name(std::declval<C&>() __VA_ARGS__))>> : std::true_type {};
+
+namespace async_detail {
+ASYNC_HANDLER_DETECT(on_connected)
+ASYNC_HANDLER_DETECT(on_disconnected)
+ASYNC_HANDLER_DETECT(on_sent, , std::declval<size_t>(), std::declval<uint32_t>())
+ASYNC_HANDLER_DETECT(on_error, , std::declval<err_t>())
+ASYNC_HANDLER_DETECT(on_data, , std::declval<void*>(), std::declval<size_t>())
+ASYNC_HANDLER_DETECT(on_poll)
+ASYNC_HANDLER_DETECT(on_timeout, , std::declval<uint32_t>())
+ASYNC_HANDLER_DETECT(on_recycle)
+}
+
+#undef ASYNC_HANDLER_DETECT
+
+/// @brief 编译期回调策略：事件直接调用 Handler 的成员函数，可被内联；Handler 未提供的事件不会被调度。
+/// Handler 可提供以下成员（Client 为 BasicAsyncClient<Handler>）：
+///   void on_connected(Client&);
+///   void on_disconnected(Client&);
+///   void on_sent(Client&, size_t len, uint32_t time);
+///   void on_error(Client&, err_t err);
+///   void on_data(Client&, void* data, size_t len);
+///   void on_poll(Client&);
+///   void on_timeout(Client&, uint32_t time);     // 未提供时ACK超时将关闭连接
+///   void on_recycle(Client&);
+template <class Handler>
+struct HandlerPolicy {
+    using Client = BasicAsyncClient<Handler>;
+
+    static constexpr bool has_connected     = async_detail::has_on_connected_t<Handler, Client>::value;
+    static constexpr bool has_disconnected  = async_detail::has_on_disconnected_t<Handler, Client>::value;
+    static constexpr bool has_sent          = async_detail::has_on_sent_t<Handler, Client>::value;
+    static constexpr bool has_error         = async_detail::has_on_error_t<Handler, Client>::value;
+    static constexpr bool has_data          = async_detail::has_on_data_t<Handler, Client>::value;
+    static constexpr bool has_poll          = async_detail::has_on_poll_t<Handler, Client>::value;
+    static constexpr bool has_timeout       = async_detail::has_on_timeout_t<Handler, Client>::value;
+    static constexpr bool has_recycle       = async_detail::has_on_recycle_t<Handler, Client>::value;
+
+    static Client& client(AsyncClient* c) {
+        return *static_cast<Client*>(c);
+    }
+    static void on_connected(AsyncClient* c) {
+        if constexpr (has_connected) {
+            client(c).handler().on_connected(client(c));
+        }
+    }
+    static void on_disconnected(AsyncClient* c) {
+        if constexpr (has_disconnected) {
+            client(c).handler().on_disconnected(client(c));
+        }
+    }
+    static void on_sent(AsyncClient* c, size_t len, uint32_t time) {
+        if constexpr (has_sent) {
+            client(c).handler().on_sent(client(c), len, time);
+        }
+    }
+    static void on_error(AsyncClient* c, err_t err) {
+        if constexpr (has_error) {
+            client(c).handler().on_error(client(c), err);
+        }
+    }
+    static void on_data(AsyncClient* c, pbuf* pb) {
+        if constexpr (has_data) {
+            auto& self = client(c);
+            while (pb) {
+                auto* current = pb;
+                pb = pb->next;
+                self.handler().on_data(self, current->payload, current->len);
+            }
+        }
+    }
+    static void on_poll(AsyncClient* c) {
+        if constexpr (has_poll) {
+            client(c).handler().on_poll(client(c));
+        }
+    }
+    static bool on_timeout(AsyncClient* c, uint32_t time) {
+        if constexpr (has_timeout) {
+            client(c).handler().on_timeout(client(c), time);
+        }
+        return has_timeout;
+    }
+    static void on_recycle(AsyncClient* c) {
+        if constexpr (has_recycle) {
+            client(c).handler().on_recycle(client(c));
+        }
+    }
+};
+
+/// @brief 静态分发的异步TCP连接：事件回调由 Handler 在编译期确定，不经过回调表。
+/// 发送、关闭等接口与 AsyncClient 相同；AsyncClient 本身即回调表（AsyncClientProfile）策略下的类型擦除版本。
+template <class Handler>
+class BasicAsyncClient : public AsyncClient {
+public:
+    BasicAsyncClient()
+        : AsyncClient(Ops<HandlerPolicy<Handler>>())
+    {}
+
+    /// @brief 获取本连接的事件处理对象
+    Handler& handler() {
+        return handler_;
+    }
+
+    // 事件回调由 Handler 在编译期确定，运行时回调表不会被使用
+    void set_profile(const AsyncClientProfile* profile) = delete;
+    void set_connected_event_handler(AcConnectHandler cb, void* arg = nullptr) = delete;
+    void set_disconnected_event_handler(AcDisConnectHandler cb, void* arg = nullptr) = delete;
+    void set_ack_event_handler(AcAckHandler cb, void* arg = nullptr) = delete;
+    void set_error_event_handler(AcErrorHandler cb, void* arg = nullptr) = delete;
+    void set_data_received_handler(AcDataHandler cb, void* arg = nullptr) = delete;
+    void set_timeout_event_handler(AcTimeoutHandler cb, void* arg = nullptr) = delete;
+    void set_poll_event_handler(AcPollHandler cb, void* arg = nullptr) = delete;
+    void set_recycle_handler(AcRecycleHandler cb, void* arg) = delete;
+
+private:
+    Handler handler_;
+};
+
+#endif
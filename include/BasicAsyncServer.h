@@ -0,0 +1,27 @@
+#ifndef BASICASYNCSERVER_H_
+#define BASICASYNCSERVER_H_
+
+#include "AsyncServer.h"
+#include "BasicAsyncClient.h"
+
+/// @brief 静态分发的异步TCP服务器：接入的连接均为 BasicAsyncClient<Handler>，
+/// 接入事件调用 Handler::on_connected（未提供时不调度接入事件）。
+template <class Handler>
+class BasicAsyncServer : public AsyncServer {
+public:
+    BasicAsyncServer(ip_addr_t addr, uint16_t port)
+        : AsyncServer(addr, port)
+    {
+        set_client_factory([]() -> AsyncClient* {
+            return new BasicAsyncClient<Handler>();
+        });
+        if constexpr (HandlerPolicy<Handler>::has_connected) {
+            set_connected_handler([](void* arg, AsyncClient* c) {
+                HandlerPolicy<Handler>::on_connected(c);
+            }, nullptr);
+        }
+    }
+    BasicAsyncServer(uint16_t port) : BasicAsyncServer(IPADDR4_INIT(0), port) {}
+};
+
+#endif
@@ -0,0 +1,376 @@
+#ifndef ASYNC_DETAIL_CLIENT_EVENTS_H_
+#define ASYNC_DETAIL_CLIENT_EVENTS_H_
+
+// AsyncClient 事件路径的模板实现（内部头文件，由 AsyncClient.cc 与 BasicAsyncClient.h 包含，不应直接使用）。
+// 事件回调由回调策略（Policy）在编译期决定：运行时版本使用 ProfilePolicy 经回调表分发，
+// BasicAsyncClient<Handler> 使用 Handler 的成员函数；策略未提供的事件不会被调度。
+
+#include "../AsyncClient.h"
+#include "../AsyncProfile.h"
+#include "esp_log.h"
+#include "my_sysInfo.h"
+
+/// @brief 获取回调策略对应的lwIP回调入口
+template <class Policy>
+const AsyncClient::client_ops_t* AsyncClient::Ops()
+{
+    static const client_ops_t ops = {
+        &AsyncClient::InstallCallbacks<Policy>,
+        &AsyncClient::ConnectedCallback<Policy>,
+        [](AsyncClient* self) {
+            self->recycle<Policy>();
+        },
+        [](AsyncClient* self, err_t err) {
+            self->HandleErrorEvent<Policy>(err);
+        },
+    };
+    return &ops;
+}
+
+/// @brief 向pcb注册回调（在pcb所属上下文中调用）
+template <class Policy>
+void AsyncClient::InstallCallbacks(AsyncClient* self)
+{
+    auto* pcb = self->pcb_;
+    tcp_arg(pcb, self);
+    tcp_recv(pcb, [](void* arg, tcp_pcb* pcb, pbuf* pb, err_t err) ->err_t {
+        auto* self = reinterpret_cast<AsyncClient*>(arg);
+        if (pb) {
+            self->HandleReceiveEvent<Policy>(pb);
+        } else {
+            self->close();
+            self->HandleFinEvent<Policy>();
+        }
+        return ERR_OK;
+    });
+    tcp_sent(pcb, [](void* arg, tcp_pcb* pcb, uint16_t len) -> err_t {
+        auto* self = reinterpret_cast<AsyncClient*>(arg);
+        if (self->HasPendingTx()) {
+            self->DrainTx();
+        }
+        // 发送窗口已打开，继续填充流式数据
+        if (self->stream_) {
+            self->PumpStream();
+        }
+        self->ShutdownWhenDrained();
+        self->HandleSentEvent<Policy>(len);
+        return ERR_OK;
+    });
+    tcp_err(pcb, [](void* arg, err_t err) {
+        auto* self = reinterpret_cast<AsyncClient*>(arg);
+        self->close();
+        self->pcb_ = nullptr;       // LWIP已经释放，防止二次释放
+        self->HandleErrorEvent<Policy>(err);
+    });
+    tcp_poll(pcb, [](void* arg, tcp_pcb* pcb) -> err_t {
+        auto* self = reinterpret_cast<AsyncClient*>(arg);
+        if (self->HasPendingTx()) {
+            self->DrainTx();
+        }
+        // 限速令牌已补充或数据源曾暂无数据时，继续填充流式数据
+        if (self->stream_) {
+            self->PumpStream();
+        }
+        self->ShutdownWhenDrained();
+        self->HandlePollEvent<Policy>();
+        return ERR_OK;
+    }, 1);
+}
+
+template <class Policy>
+err_t AsyncClient::ConnectedCallback(void* arg, tcp_pcb* pcb, err_t err)
+{
+    auto* self = reinterpret_cast<AsyncClient*>(arg);
+    self->HandleConnectEvent<Policy>();
+    return ERR_OK;
+}
+
+/// @brief 回收本连接
+template <class Policy>
+void AsyncClient::recycle()
+{
+    if (!IsActive() && events_.load() == 0) {
+        // 上层回收逻辑
+        if constexpr (Policy::has_recycle) {
+            Policy::on_recycle(this);
+        }
+        Release();
+    }
+}
+
+template <class Policy>
+void AsyncClient::HandleReceiveEvent(pbuf* pb)
+{
+    last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
+    defer_ack_ = false;
+#if CONFIG_ASYNC_RX_AUTOTUNE
+    // 接收窗口打开后到达的首个数据：以窗口打开至数据到达的时间作为往返时间样本
+    if (rx_probe_start_) {
+        RxSampleRtt(last_rx_timestamp_ - rx_probe_start_);
+        rx_probe_start_ = 0;
+    }
+#endif
+    if constexpr (!Policy::has_data) {
+        // 无数据回调：直接确认并释放
+        AckRx(pb->tot_len);
+        pbuf_free(pb);
+        return;
+    }
+    auto* event = new async_event_t;
+    event->arg = this;
+    event->buf = pb;
+    event->tot_len = pb->tot_len;
+    events_++;      // 先计数再调度，避免清理函数先于计数执行而漏掉回收
+    auto ok = async_schedule(AsyncPriority::Data, [](void* arg) {
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+#if CONFIG_ASYNC_TCP_PROFILING
+            size_t segments = 0;
+            for (auto* pb = event->buf; pb; pb = pb->next) {
+                segments++;
+            }
+            async_prof_timer_t timer;
+            Policy::on_data(self, event->buf);
+            uint32_t cycles;
+            if (timer.elapsed(&cycles)) {
+                async_prof_record_chain(segments, cycles);
+            }
+#else
+            Policy::on_data(self, event->buf);
+#endif
+        },
+        event,
+        [](void* arg) {
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            auto* pb = event->buf;
+            auto tot_len = event->tot_len;
+            if (tot_len) {
+                if (self->defer_ack_) {
+                    self->unack_rx_bytes_ += tot_len;
+                } else {
+                    if (self->pcb_) {
+                        lwip_data_t msg = {};
+                        msg.client = self;
+                        msg.ack_len = tot_len;
+                        tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+                                auto* msg = reinterpret_cast<lwip_data_t*>(data);
+                                msg->client->AckRx(msg->ack_len);
+                                return ERR_OK;
+                            },
+                            (tcpip_api_call_data*)&msg);
+                    }
+                }
+            }
+            pbuf_free(pb);
+            self->events_ --;
+            delete event;
+            self->recycle<Policy>();
+        }
+    );
+    if (!ok) {
+        // 无法交付时直接确认并释放，避免接收窗口永久缩小
+        events_--;
+        AckRx(pb->tot_len);
+        pbuf_free(pb);
+        delete event;
+    }
+}
+
+template <class Policy>
+void AsyncClient::HandleFinEvent()
+{
+    auto* event = new async_event_t;
+    event->arg = this;
+    auto prio = TeardownPriority();
+    events_++;
+    auto ok = async_schedule(prio, [](void* arg){
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            if constexpr (Policy::has_disconnected) {
+                Policy::on_disconnected(self);
+            }
+        },
+        event,
+        [](void* arg) {
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            xEventGroupClearBits(self->event_group_, ASYNC_TCP_ACTIVE_BIT);
+            self->events_--;
+            delete event;
+            self->recycle<Policy>();
+        }
+    );
+    if (!ok) {
+        events_--;
+        delete event;
+    }
+}
+
+template <class Policy>
+void AsyncClient::HandleErrorEvent(err_t err)
+{
+    // 处理错误
+    xEventGroupClearBits(event_group_, ASYNC_TCP_ACTIVE_BIT | ASYNC_TCP_CAN_SEND_BIT);
+
+    auto* event = new async_event_t;
+    event->arg = this;
+    event->err = err;
+    auto prio = TeardownPriority();
+    events_++;
+    auto ok = async_schedule(prio, [](void* arg){
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            if constexpr (Policy::has_error) {
+                Policy::on_error(self, event->err);
+            }
+        },
+        event,
+        [](void* arg){
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            self->events_--;
+            delete event;
+            self->recycle<Policy>();
+        }
+    );
+    if (!ok) {
+        events_--;
+        delete event;
+    }
+}
+
+template <class Policy>
+void AsyncClient::HandlePollEvent()
+{
+    // 启用ACK超时后统计已发送数据等待确认的时间（以轮询周期为粒度），超时后重新计时，超时回调每个超时周期最多触发一次
+    auto now = SystemInfo::GetMsSinceStart();
+    uint32_t ack_wait = 0;
+    if (ack_timeout_ms_ == 0 || pcb_->unacked == nullptr) {
+        ack_wait_start_ = 0;
+    } else if (ack_wait_start_ == 0) {
+        ack_wait_start_ = now ? now : 1;
+    } else if (now - ack_wait_start_ >= ack_timeout_ms_) {
+        ack_wait = now - ack_wait_start_;
+        ack_wait_start_ = now ? now : 1;
+    }
+    // 无轮询回调、未设置接收超时且未发生ACK超时时无需调度
+    if (!Policy::has_poll && rx_timeout_second_ == 0 && ack_wait == 0) {
+        return;
+    }
+    // 同一连接已有待处理的轮询事件时跳过本次轮询
+    if (poll_pending_.exchange(true)) {
+        return;
+    }
+    auto* event = new async_event_t;
+    event->arg = this;
+    event->poll_time = now;
+    event->ack_wait = ack_wait;
+    events_++;
+    auto ok = async_schedule(AsyncPriority::Poll, [](void* arg) {
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            if (self->IsActive()) {
+                if (event->ack_wait) {
+                    bool handled = false;
+                    if constexpr (Policy::has_timeout) {
+                        handled = Policy::on_timeout(self, event->ack_wait);
+                    }
+                    if (!handled) {
+                        self->close();
+                        ESP_LOGW("AsyncClient", "ACK timeout, connection closed.");
+                    }
+                }
+                if (self->rx_timeout_second_ && SystemInfo::Timeout(self->last_rx_timestamp_, event->poll_time, self->rx_timeout_second_ * 1000)) {
+                    self->close();
+                    ESP_LOGW("AsyncClient", "Receive timeout, connection closed.");
+                }
+                if constexpr (Policy::has_poll) {
+                    Policy::on_poll(self);
+                }
+            }
+        },
+        event,
+        [](void* arg) {
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            self->poll_pending_ = false;
+            self->events_--;
+            delete event;
+            self->recycle<Policy>();
+        }
+    );
+    if (!ok) {
+        events_--;
+        poll_pending_ = false;
+        delete event;
+    }
+}
+
+template <class Policy>
+void AsyncClient::HandleConnectEvent()
+{
+    last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
+    if constexpr (!Policy::has_connected) {
+        xEventGroupSetBits(event_group_, ASYNC_TCP_ACTIVE_BIT);
+        return;
+    }
+    events_++;
+    auto ok = async_schedule(AsyncPriority::Control, [](void* arg) {
+            auto* self = reinterpret_cast<AsyncClient*>(arg);
+            self->last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
+            Policy::on_connected(self);
+        },
+        this,
+        [](void* arg){
+            auto* self = reinterpret_cast<AsyncClient*>(arg);
+            xEventGroupSetBits(self->event_group_, ASYNC_TCP_ACTIVE_BIT);
+            self->events_--;
+            self->recycle<Policy>();
+        });
+    if (!ok) {
+        events_--;
+    }
+}
+
+template <class Policy>
+void AsyncClient::HandleSentEvent(uint16_t len)
+{
+    // 确认有进展，重新计算ACK等待时间
+    if (pcb_) {
+        ack_wait_start_ = pcb_->unacked ? SystemInfo::GetMsSinceStart() : 0;
+    }
+    // 立即解除发送状态
+    xEventGroupSetBits(event_group_, ASYNC_TCP_CAN_SEND_BIT);
+    xEventGroupClearBits(event_group_, ASYNC_TCP_SENDDING_BIT);
+    // 无发送完成回调时无需调度
+    if (!Policy::has_sent) {
+        return;
+    }
+    auto* event = new async_event_t;
+    event->arg = this;
+    event->time = SystemInfo::GetMsSinceStart() - last_tx_timestamp_;
+    event->len = len;
+    events_++;
+    auto ok = async_schedule(AsyncPriority::Data, [](void* arg) {
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            if constexpr (Policy::has_sent) {
+                Policy::on_sent(self, event->len, event->time);
+            }
+        },
+        event,
+        [](void* arg){
+            auto* event = reinterpret_cast<async_event_t*>(arg);
+            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
+            self->events_--;
+            delete event;
+            self->recycle<Policy>();
+        });
+    if (!ok) {
+        events_--;
+        delete event;
+    }
+}
+
+#endif
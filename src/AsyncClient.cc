@@ -2,50 +2,106 @@
 #include "AsyncServer.h"
 #include "my_sysInfo.h"
 #include "esp_log.h"
+#include "freertos/task.h"
 #include "async.h"
+#include "client_events.h"
+#include "AsyncProfile.h"
 #include "lwip/dns.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include <new>
+#include <string.h>
 #include "my_sysInfo.h"
 
 #define TAG "AsyncClient"
+#define ASYNC_CORK_RETRY_US         1000    // tcpip消息队列已满时合包定时器的重试间隔
 
-#define ASYNC_TCP_ACTIVE_BIT    BIT0    // 活跃状态
-#define ASYNC_TCP_SENDDING_BIT  BIT1    // 正在发送
-#define ASYNC_TCP_CAN_SEND_BIT  BIT2    // 可以发送
+#if CONFIG_ASYNC_RX_AUTOTUNE
+#define ASYNC_RX_DEFAULT_RTT_MS     100     // 尚无往返时间样本时使用的估计值
+#define ASYNC_RX_MIN_SAMPLE_MS      20      // 处理速度采样的最短周期
 
-struct notify_data_t {
-    tcpip_api_call_data*    data;
-    tcp_pcb*                pcb;
-    uint16_t                len;
-};
+static uint32_t s_rx_reserved = 0;          // 所有连接目标接收窗口之和（仅在tcpip线程访问）
+#endif
 
+const AsyncClientProfile AsyncClient::empty_profile_;
+AsyncClient::async_tx_t AsyncClient::tx_closed_;
 
 AsyncClient::AsyncClient()
-    : bg_(MyBackground::GetInstance())
+    : AsyncClient(Ops<ProfilePolicy>())
+{
+}
+
+AsyncClient::AsyncClient(const client_ops_t* ops)
+    : ops_(ops)
 {
     event_group_ = xEventGroupCreate();
 }
 
-// 回收本连接
-void AsyncClient::recycle()
+/// @brief 释放本连接的资源并归还服务器连接池
+void AsyncClient::Release()
 {
-    if (!IsActive() && events_.load() == 0) {
-        // 上层回收逻辑
-        if (on_recycle_handler) {
-            on_recycle_handler(on_recycle_arg);
-        }
-        // 释放pcb
-        close_tcp(pcb_);
-        pcb_ = nullptr;
+    // 停止合包定时器
+    if (cork_timer_) {
+        esp_timer_stop(cork_timer_);
+    }
+    // 移出服务器的在线连接表，此后批量关闭不会再访问本连接
+    if (server_) {
+        server_->untrackClient(this);
+    }
+    // 结束流式发送、丢弃未发出的异步数据并释放pcb（在同一次tcpip调用中完成，晚于此前提交的发送请求，
+    // 且不会与同在tcpip线程中运行的流式填充交错）
+    lwip_data_t msg = {};
+    msg.client = this;
+    tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+            ASYNC_PROF_SCOPE(Recycle);
+            auto* self = reinterpret_cast<lwip_data_t*>(data)->client;
+            self->EndStream();
+            self->DropTx();
+            self->CancelEgress();
+#if CONFIG_ASYNC_RX_AUTOTUNE
+            self->RxRelease();
+#endif
+            auto* pcb = self->pcb_;
+            self->pcb_ = nullptr;
+            if (pcb == nullptr) {
+                return ERR_OK;
+            }
+            return tcp_close(pcb);
+        },
+        (tcpip_api_call_data*)&msg);
 
-        // 回收本层资源
-        server_->recycleClient(this);
+    // 回收本层资源（主动连接不属于服务器）
+    if (server_) {
+        server_->releaseClient(this);
     }
 }
 
 /// @brief 释放异步TCP连接
 AsyncClient::~AsyncClient()
 {
+    CancelConnect();
+    if (cork_timer_) {
+        esp_timer_stop(cork_timer_);
+        esp_timer_delete(cork_timer_);
+    }
     vEventGroupDelete(event_group_);
+    delete own_profile_;
+    ::operator delete(stream_);
+    DropTx();
+}
+
+/// @brief 获取本连接独占的回调表，当前使用共享回调表时复制一份后再修改
+AsyncClientProfile& AsyncClient::own_profile()
+{
+    if (profile_ != own_profile_) {
+        if (own_profile_ == nullptr) {
+            own_profile_ = new AsyncClientProfile;
+        }
+        *own_profile_ = *profile_;
+        profile_ = own_profile_;
+    }
+    return *own_profile_;
 }
 
 /// @brief 判断连接是否在线
@@ -64,63 +120,39 @@ bool AsyncClient::IsSendding()
     return (bits & ASYNC_TCP_SENDDING_BIT);
 }
 
-void AsyncClient::init(AsyncServer* server, tcp_pcb* pcb)
+void AsyncClient::init(AsyncServer* server, tcp_pcb* pcb, const AsyncClientProfile* profile)
 {
     unack_rx_bytes_ = 0;
     last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
     last_tx_timestamp_ = last_rx_timestamp_;
-    ack_timeout_ms_ = CONFIG_ASYNC_MAX_ACK_TIME;
+    ack_timeout_ms_ = 0;
+    ack_wait_start_ = 0;
     rx_timeout_second_ = 0;
     nodelay_ = false;
     defer_ack_ = false;
+    auto_cork_ = false;
+    corked_bytes_ = 0;
+    poll_pending_ = false;
+    egress_ = token_bucket_t();
+    deficit_ = 0;
+    closing_ = false;
+    // 重新开放异步发送队列（上一个连接释放时已关闭并清空）
+    tx_drain_pending_ = false;
+    tx_inbox_ = nullptr;
+#if CONFIG_ASYNC_RX_AUTOTUNE
+    rx_withheld_ = 0;
+    rx_rate_ = 0;
+    rx_srtt_ms_ = 0;
+    rx_probe_start_ = 0;
+    rx_sample_bytes_ = 0;
+    rx_sample_start_ = last_rx_timestamp_;
+#endif
     pcb_ = pcb;
     server_ = server;
 
-    on_connected_handler    = nullptr;
-    on_disconnected_handler = nullptr;
-    on_data_sent_handler    = nullptr;
-    on_error_handler        = nullptr;
-    on_data_received_handler = nullptr;
-    on_timeout_handler      = nullptr;
-    on_poll_handler         = nullptr;
-    on_recycle_handler      = nullptr;
-
-    on_connected_arg    = nullptr;
-    on_disconnected_arg = nullptr;
-    on_data_sent_arg    = nullptr;
-    on_error_arg        = nullptr;
-    on_data_received_arg = nullptr;
-    on_timeout_arg      = nullptr;
-    on_poll_arg         = nullptr;
-    on_recycle_arg      = nullptr;
-
-    tcp_arg(pcb_, this);
-    tcp_recv(pcb_, [](void* arg, tcp_pcb* pcb, pbuf* pb, err_t err) ->err_t {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        if (pb) {
-            self->HandleReceiveEvent(pb);
-        } else {
-            self->close();
-            self->HandleFinEvent();
-        }
-        return ERR_OK;
-    });
-    tcp_sent(pcb_, [](void* arg, tcp_pcb* pcb, uint16_t len) -> err_t {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        self->HandleSentEvent(len);
-        return ERR_OK;
-    });
-    tcp_err(pcb_, [](void* arg, err_t err) {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        self->close();
-        self->pcb_ = nullptr;       // LWIP已经释放，防止二次释放
-        self->HandleErrorEvent(err);
-    });
-    tcp_poll(pcb_, [](void* arg, tcp_pcb* pcb) -> err_t {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        self->HandlePollEvent();
-        return ERR_OK;
-    }, 1);
+    profile_ = profile ? profile : &empty_profile_;
+
+    ops_->install(this);
 
     xEventGroupSetBits(event_group_, ASYNC_TCP_ACTIVE_BIT | ASYNC_TCP_CAN_SEND_BIT);
     xEventGroupClearBits(event_group_, ASYNC_TCP_SENDDING_BIT);
@@ -132,276 +164,284 @@ void AsyncClient::initClient()
     unack_rx_bytes_ = 0;
     last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
     last_tx_timestamp_ = last_rx_timestamp_;
-    ack_timeout_ms_ = CONFIG_ASYNC_MAX_ACK_TIME;
+    ack_timeout_ms_ = 0;
+    ack_wait_start_ = 0;
     rx_timeout_second_ = 0;
     nodelay_ = false;
     defer_ack_ = false;
+    auto_cork_ = false;
+    corked_bytes_ = 0;
+    poll_pending_ = false;
+    egress_ = token_bucket_t();
+    deficit_ = 0;
+    closing_ = false;
+    // 重新开放异步发送队列（上一个连接释放时已关闭并清空）
+    tx_drain_pending_ = false;
+    tx_inbox_ = nullptr;
+#if CONFIG_ASYNC_RX_AUTOTUNE
+    rx_withheld_ = 0;
+    rx_rate_ = 0;
+    rx_srtt_ms_ = 0;
+    rx_probe_start_ = 0;
+    rx_sample_bytes_ = 0;
+    rx_sample_start_ = last_rx_timestamp_;
+#endif
 
-    tcp_arg(pcb_, this);
-    tcp_recv(pcb_, [](void* arg, tcp_pcb* pcb, pbuf* pb, err_t err) ->err_t {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        if (pb) {
-            self->HandleReceiveEvent(pb);
-        } else {
-            self->close();
-            self->HandleFinEvent();
-        }
-        return ERR_OK;
-    });
-    tcp_sent(pcb_, [](void* arg, tcp_pcb* pcb, uint16_t len) -> err_t {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        self->HandleSentEvent(len);
-        return ERR_OK;
-    });
-    tcp_err(pcb_, [](void* arg, err_t err) {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        self->close();
-        self->pcb_ = nullptr;       // LWIP已经释放，防止二次释放
-        self->HandleErrorEvent(err);
-    });
-    tcp_poll(pcb_, [](void* arg, tcp_pcb* pcb) -> err_t {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        self->HandlePollEvent();
-        return ERR_OK;
-    }, 1);
-
+    // 回调在连接建立、确定使用的pcb后注册
     xEventGroupSetBits(event_group_, ASYNC_TCP_ACTIVE_BIT | ASYNC_TCP_CAN_SEND_BIT);
     xEventGroupClearBits(event_group_, ASYNC_TCP_SENDDING_BIT);
 }
 
 
-void AsyncClient::HandleReceiveEvent(pbuf* pb)
+/// 进行中的主动连接：向各候选端点错开发起连接，先完成握手的胜出
+struct AsyncClient::connect_race_t {
+    struct attempt_t {
+        connect_race_t* race;
+        tcp_pcb*        pcb;        // 为空表示尚未发起或已失败
+    };
+    AsyncClient*    client;
+    AsyncEndpoint*  endpoints;
+    attempt_t*      attempts;
+    size_t          count;
+    size_t          next{0};        // 下一个待尝试的端点
+    size_t          pending{0};     // 进行中的尝试数
+    uint32_t        stagger_ms;
+    uint32_t        timeout_ms;
+    err_t           last_err{ERR_CONN};
+
+    ~connect_race_t() {
+        delete[] endpoints;
+        delete[] attempts;
+    }
+};
+
+bool AsyncClient::connect(ip_addr_t& addr, uint16_t port)
 {
-    last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
-    defer_ack_ = false;
-    auto* event = new async_event_t;
-    event->arg = this;
-    event->buf = pb;
-    event->tot_len = pb->tot_len;
-    auto ok = bg_.Schedule(
-        [](void* arg) {
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            auto* pb = event->buf;
-            if (self->on_data_received_handler != nullptr) {
-                while (pb) {
-                    auto* current = pb;
-                    pb = pb->next;
-                    self->on_data_received_handler(self->on_data_received_arg, current->payload, current->len);
-                }
-            }
-        },
-        "Rece Event",
-        event,
-        [](void* arg) {
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            auto* pb = event->buf;
-            auto tot_len = event->tot_len;
-            if (tot_len) {
-                if (self->defer_ack_) {
-                    self->unack_rx_bytes_ += tot_len;
-                } else {
-                    if (self->pcb_) {
-                        notify_data_t msg = {
-                            .data = nullptr,
-                            .pcb = self->pcb_,
-                            .len = tot_len
-                        };
-                        tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
-                                auto* msg = reinterpret_cast<notify_data_t*>(data);
-                                tcp_recved(msg->pcb, msg->len);
-                                return ERR_OK;
-                            },
-                            (tcpip_api_call_data*)&msg);
-                    }
-                }
-            }
-            pbuf_free(pb);
-            self->events_ --;
-            delete event;
-            self->recycle();
-        }
-    );
-    if (ok) events_++;
+    AsyncEndpoint endpoint = { addr, port };
+    return connect(&endpoint, 1);
 }
 
-void AsyncClient::HandleFinEvent()
+/// @brief 向多个候选端点发起连接：每隔stagger_ms向下一个端点发起尝试，某个端点失败时立即尝试下一个；
+/// 先完成握手的连接胜出，其余尝试被中止。超过timeout_ms仍未建立时以ERR_TIMEOUT通知错误回调，
+/// 所有端点均失败时以最后一个错误通知错误回调。
+/// @param timeout_ms 整体截止时间（毫秒），0表示使用CONFIG_CONNECT_TIMEOUT
+/// @return 未能发起任何连接尝试时返回false（不会触发错误回调）
+bool AsyncClient::connect(const AsyncEndpoint* endpoints, size_t count, uint32_t stagger_ms, uint32_t timeout_ms)
 {
-    auto* event = new async_event_t;
-    event->arg = this;
-    auto ok =bg_.Schedule(
-        [](void* arg){
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            if (self->on_disconnected_handler) {
-                self->on_disconnected_handler(self->on_disconnected_arg);
+    if (endpoints == nullptr || count == 0) {
+        return false;
+    }
+    if (pcb_ || connecting_.exchange(true)) {
+        ESP_LOGW(TAG, "当前已存在建立的连接，放弃操作.");
+        return false;
+    }
+
+    auto* race = new (std::nothrow) connect_race_t;
+    if (race) {
+        race->endpoints = new (std::nothrow) AsyncEndpoint[count];
+        race->attempts = new (std::nothrow) connect_race_t::attempt_t[count];
+    }
+    if (race == nullptr || race->endpoints == nullptr || race->attempts == nullptr) {
+        ESP_LOGE(TAG, "连接建立失败：申请内存失败");
+        delete race;
+        connecting_ = false;
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        race->endpoints[i] = endpoints[i];
+        race->attempts[i] = { race, nullptr };
+    }
+    race->client = this;
+    race->count = count;
+    race->stagger_ms = stagger_ms;
+    race->timeout_ms = timeout_ms ? timeout_ms : CONFIG_CONNECT_TIMEOUT * 1000;
+
+    initClient();
+    race_ = race;
+
+    lwip_data_t msg = {};
+    msg.client = this;
+    auto err = tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+            auto* self = reinterpret_cast<lwip_data_t*>(data)->client;
+            auto* race = self->race_;
+            if (!RaceLaunch(race)) {
+                auto err = race->last_err;
+                self->race_ = nullptr;
+                delete race;
+                return err;
             }
+            sys_timeout(race->timeout_ms, RaceDeadline, race);
+            if (race->next < race->count) {
+                sys_timeout(race->stagger_ms, RaceStagger, race);
+            }
+            return ERR_OK;
         },
-        "Fin Event",
-        event,
-        [](void* arg) {
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            xEventGroupClearBits(self->event_group_, ASYNC_TCP_ACTIVE_BIT);
-            self->events_--;
-            delete event;
-            self->recycle();
-        }
-    ); 
-    if (ok) events_++;
+        (tcpip_api_call_data*)&msg);
+
+    if (err != ERR_OK) {
+        ESP_LOGE(TAG, "连接建立失败：%d", err);
+        xEventGroupClearBits(event_group_, ASYNC_TCP_ACTIVE_BIT);
+        connecting_ = false;
+        return false;
+    }
+    return true;
 }
 
-void AsyncClient::HandleErrorEvent(err_t err)
+/// @brief 向下一个候选端点发起连接（仅在tcpip线程中调用）
+/// @return 成功发起一次尝试时返回true，已无可尝试的端点时返回false
+bool AsyncClient::RaceLaunch(connect_race_t* race)
 {
-    // 处理错误
-    xEventGroupClearBits(event_group_, ASYNC_TCP_ACTIVE_BIT | ASYNC_TCP_CAN_SEND_BIT);
+    while (race->next < race->count) {
+        auto& endpoint = race->endpoints[race->next];
+        auto& attempt = race->attempts[race->next];
+        race->next++;
 
-    auto* event = new async_event_t;
-    event->arg = this;
-    event->err = err;
-    auto ok = bg_.Schedule(
-        [](void* arg){
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            if (self->on_error_handler) {
-                self->on_error_handler(self->on_error_arg, event->err);
-            }
-        },
-        "Error Event",
-        event,
-        [](void* arg){
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            self->events_--;
-            delete event;
-            self->recycle();
+        auto* pcb = tcp_new_ip_type(IP_GET_TYPE(&endpoint.addr));
+        if (pcb == nullptr) {
+            race->last_err = ERR_MEM;
+            continue;
         }
-    );   
-    if (ok) events_++; 
-}
-
-void AsyncClient::HandlePollEvent()
-{
-    auto* event = new async_event_t;
-    event->arg = this;
-    event->poll_time = SystemInfo::GetMsSinceStart();
-    auto ok = bg_.Schedule(
-        [](void* arg) {
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            if (self->IsActive()) {
-                // 逻辑存在问题
-                // if (self->IsSendding() && SystemInfo::Timeout(self->last_tx_timestamp_, event->poll_time, self->ack_timeout_ms_)) {
-                //     if (self->on_timeout_handler) {
-                //         self->on_timeout_handler(self->on_timeout_arg, event->poll_time - self->last_tx_timestamp_);
-                //     } else {
-                //         self->close();
-                //         ESP_LOGW(TAG, "ACK timeout, connection closed.");
-                //     }
-                // }
-                if (self->rx_timeout_second_ && SystemInfo::Timeout(self->last_rx_timestamp_, event->poll_time, self->rx_timeout_second_ * 1000)) {
-                    self->close();
-                    ESP_LOGW(TAG, "Receive timeout, connection closed.");
-                }
-                if (self->on_poll_handler) {
-                    self->on_poll_handler(self->on_poll_arg);
+        tcp_arg(pcb, &attempt);
+        tcp_err(pcb, [](void* arg, err_t err) {
+            // 该尝试失败（pcb已由lwIP释放），立即尝试下一个端点
+            auto* attempt = reinterpret_cast<connect_race_t::attempt_t*>(arg);
+            auto* race = attempt->race;
+            attempt->pcb = nullptr;
+            race->pending--;
+            race->last_err = err;
+            sys_untimeout(RaceStagger, race);
+            if (RaceLaunch(race)) {
+                if (race->next < race->count) {
+                    sys_timeout(race->stagger_ms, RaceStagger, race);
                 }
+            } else if (race->pending == 0) {
+                RaceFinish(race, nullptr, race->last_err);
             }
-        },
-        "Poll Event",
-        event,
-        [](void* arg) {
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            self->events_--;
-            delete event;
-            self->recycle();
+        });
+        auto err = tcp_connect(pcb, &endpoint.addr, endpoint.port, [](void* arg, tcp_pcb* pcb, err_t err) -> err_t {
+            auto* attempt = reinterpret_cast<connect_race_t::attempt_t*>(arg);
+            RaceFinish(attempt->race, pcb, ERR_OK);
+            return ERR_OK;
+        });
+        if (err != ERR_OK) {
+            tcp_arg(pcb, nullptr);
+            tcp_err(pcb, nullptr);
+            tcp_abort(pcb);
+            race->last_err = err;
+            continue;
         }
-    );
-    if (ok) events_++;
+        attempt.pcb = pcb;
+        race->pending++;
+        return true;
+    }
+    return false;
 }
 
-void AsyncClient::HandleConnectEvent()
+/// @brief 到达错开间隔，在已有尝试之外再向下一个端点发起连接（在tcpip线程中运行）
+void AsyncClient::RaceStagger(void* arg)
 {
-    last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
-    auto ok = bg_.Schedule([](void* arg) {
-            auto* self = reinterpret_cast<AsyncClient*>(arg);
-            self->last_rx_timestamp_ = SystemInfo::GetMsSinceStart();
-            if (self->on_connected_handler) {
-                self->on_connected_handler(self->on_connected_arg, self);
-            }
-        },
-        "Connoect Event",
-        this,
-        [](void* arg){
-            auto* self = reinterpret_cast<AsyncClient*>(arg);
-            xEventGroupSetBits(self->event_group_, ASYNC_TCP_ACTIVE_BIT);
-            self->events_--;
-            self->recycle();
-        });
-    if (ok) events_++;
+    auto* race = reinterpret_cast<connect_race_t*>(arg);
+    if (RaceLaunch(race)) {
+        if (race->next < race->count) {
+            sys_timeout(race->stagger_ms, RaceStagger, race);
+        }
+    } else if (race->pending == 0) {
+        RaceFinish(race, nullptr, race->last_err);
+    }
 }
 
-void AsyncClient::HandleSentEvent(uint16_t len)
+/// @brief 连接截止时间已到（在tcpip线程中运行）
+void AsyncClient::RaceDeadline(void* arg)
 {
-    // 立即解除发送状态
-    xEventGroupSetBits(event_group_, ASYNC_TCP_CAN_SEND_BIT);
-    xEventGroupClearBits(event_group_, ASYNC_TCP_SENDDING_BIT);
-    auto* event = new async_event_t;
-    event->arg = this;
-    event->time = SystemInfo::GetMsSinceStart() - last_tx_timestamp_;
-    event->len = len;
-    auto ok = bg_.Schedule([](void* arg) {
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            if (self->on_data_sent_handler) {
-                self->on_data_sent_handler(self->on_data_sent_arg, event->len, event->time);
-            }
-        },
-        "Sent Event",
-        event,
-        [](void* arg){
-            auto* event = reinterpret_cast<async_event_t*>(arg);
-            auto* self = reinterpret_cast<AsyncClient*>(event->arg);
-            self->events_--;
-            delete event;
-            self->recycle();
-        });
-    if (ok) events_++;
+    RaceFinish(reinterpret_cast<connect_race_t*>(arg), nullptr, ERR_TIMEOUT);
 }
 
-bool AsyncClient::connect(ip_addr_t& addr, uint16_t port)
+/// @brief 结束主动连接：中止除胜出者外的所有尝试，胜出时注册回调并进入连接成功流程，否则通知错误回调（仅在tcpip线程中调用）
+/// @param winner 胜出的pcb，为空表示连接失败
+void AsyncClient::RaceFinish(connect_race_t* race, tcp_pcb* winner, err_t err)
 {
-    if (pcb_) {
-        ESP_LOGW(TAG, "当前已存在建立的连接，放弃操作.");
-        return false;
+    sys_untimeout(RaceStagger, race);
+    sys_untimeout(RaceDeadline, race);
+    for (size_t i = 0; i < race->count; i++) {
+        auto* pcb = race->attempts[i].pcb;
+        if (pcb && pcb != winner) {
+            tcp_arg(pcb, nullptr);
+            tcp_err(pcb, nullptr);
+            tcp_abort(pcb);
+        }
     }
+    auto* self = race->client;
+    self->race_ = nullptr;
+    delete race;
+    self->connecting_ = false;
 
-    pcb_ = tcp_new_ip_type(IPADDR_TYPE_V4);
-    if (!pcb_) {
-        ESP_LOGE(TAG, "连接建立失败：创建PCB失败");
-        return false;
+    if (winner) {
+        self->pcb_ = winner;
+        self->ops_->install(self);
+        self->ops_->connected(self, winner, ERR_OK);
+    } else {
+        ESP_LOGW(TAG, "连接建立失败：%d", err);
+        self->ops_->error(self, err);
     }
+}
 
-    initClient();
+/// @brief 当前任务是否为tcpip线程（在tcpip线程中调用tcpip_api_call会死锁）
+static bool InTcpipThread()
+{
+    static std::atomic<TaskHandle_t> s_tcpip_task{nullptr};
+    auto task = s_tcpip_task.load();
+    if (task == nullptr) {
+        task = xTaskGetHandle(TCPIP_THREAD_NAME);
+        s_tcpip_task = task;
+    }
+    return task && task == xTaskGetCurrentTaskHandle();
+}
 
-    lwip_data_t msg = {};
-    msg.pcb = pcb_;
-    msg.port = port;
-    msg.addr = &addr;
-    msg.fn = [] (void* arg, tcp_pcb* pcb, err_t err) -> err_t {
-        auto* self = reinterpret_cast<AsyncClient*>(arg);
-        self->HandleConnectEvent();
-        return ERR_OK;
-    };
-    auto err = tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
-            auto* msg = reinterpret_cast<lwip_data_t*>(data);
-            return tcp_connect(msg->pcb, msg->addr, msg->port, msg->fn);
-        },
-        (tcpip_api_call_data*)&msg);
-    
-    return err == ERR_OK;
+/// @brief 取消进行中的主动连接，不通知错误回调（可在tcpip线程中调用，包括本连接的回调）
+void AsyncClient::CancelConnect()
+{
+    if (!connecting_.load()) {
+        return;
+    }
+    err_t err;
+    if (InTcpipThread()) {
+        err = RaceCancel(this);
+    } else {
+        lwip_data_t msg = {};
+        msg.client = this;
+        err = tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+                return RaceCancel(reinterpret_cast<lwip_data_t*>(data)->client);
+            },
+            (tcpip_api_call_data*)&msg);
+    }
+    if (err == ERR_OK) {
+        xEventGroupClearBits(event_group_, ASYNC_TCP_ACTIVE_BIT);
+    }
+}
+
+/// @brief 中止所有连接尝试并释放竞争状态（仅在tcpip线程中调用）
+/// @return 连接已在此之前结束时返回ERR_CLSD
+err_t AsyncClient::RaceCancel(AsyncClient* self)
+{
+    auto* race = self->race_;
+    if (race == nullptr) {
+        // 连接已在此之前结束
+        return ERR_CLSD;
+    }
+    sys_untimeout(RaceStagger, race);
+    sys_untimeout(RaceDeadline, race);
+    for (size_t i = 0; i < race->count; i++) {
+        auto* pcb = race->attempts[i].pcb;
+        if (pcb) {
+            tcp_arg(pcb, nullptr);
+            tcp_err(pcb, nullptr);
+            tcp_abort(pcb);
+        }
+    }
+    self->race_ = nullptr;
+    delete race;
+    self->connecting_ = false;
+    return ERR_OK;
 }
 
 err_t AsyncClient::connect(const char* name, uint16_t port)
@@ -422,6 +462,8 @@ err_t AsyncClient::connect(const char* name, uint16_t port)
 /// @param now true时立即关闭连接，false时将回收连接（）
 void AsyncClient::close(bool now)
 {
+    // 连接尚未建立时取消连接尝试
+    CancelConnect();
     if (IsActive()) {
         // 注销在pcb_上的相应函数
         tcp_arg(pcb_, nullptr);
@@ -439,7 +481,12 @@ void AsyncClient::close(bool now)
 size_t AsyncClient::get_send_buffer_size()
 {
     if (IsActive() && pcb_->state == ESTABLISHED) {
-        return tcp_sndbuf(pcb_);
+        size_t room = tcp_sndbuf(pcb_);
+        if (egress_.rate) {
+            auto tokens = egress_.peek(SystemInfo::GetMsSinceStart());
+            return tokens < room ? tokens : room;
+        }
+        return room;
     }
     return 0;
 }
@@ -465,16 +512,27 @@ size_t AsyncClient::add(const void* data, size_t size, uint8_t apiflags)
 
     lwip_data_t msg = {};
     msg.pcb = pcb_;
+    msg.client = this;
     msg.write_apiflag = apiflags;
     msg.write_len = will_send;
     msg.write_data = data;
     auto err = tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+            ASYNC_PROF_SCOPE(Add);
             auto* msg = reinterpret_cast<lwip_data_t*>(data);
-            return tcp_write(msg->pcb, msg->write_data, msg->write_len, msg->write_apiflag);
+            // 按限速截断写入量
+            msg->write_len = msg->client->EgressAllow(msg->write_len);
+            if (msg->write_len == 0) {
+                return ERR_WOULDBLOCK;
+            }
+            auto err = tcp_write(msg->pcb, msg->write_data, msg->write_len, msg->write_apiflag);
+            if (err == ERR_OK) {
+                msg->client->egress_.consume(msg->write_len);
+            }
+            return err;
         },
         (tcpip_api_call_data*)&msg);
 
-    return (err != ERR_OK) ? 0 : will_send;
+    return (err != ERR_OK) ? 0 : msg.write_len;
 }
 
 /// @brief 发送队列中所有通过 add() 添加的数据。
@@ -485,8 +543,15 @@ bool AsyncClient::send()
     }
     lwip_data_t msg;
     msg.pcb = pcb_;
+    msg.client = this;
     auto err = tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+            ASYNC_PROF_SCOPE(Send);
             auto* msg = reinterpret_cast<lwip_data_t*>(data);
+            // 已累积的数据随本次输出发出，停止合包定时器
+            if (msg->client->cork_timer_) {
+                esp_timer_stop(msg->client->cork_timer_);
+            }
+            msg->client->corked_bytes_ = 0;
             return tcp_output(msg->pcb);
         },
         (tcpip_api_call_data*)&msg);
@@ -509,9 +574,608 @@ size_t AsyncClient::write(const void* data, uint16_t size, uint8_t apiflags)
     if (!IsActive() || size == 0 || data == nullptr) {
         return 0;
     }
+    if (auto_cork_) {
+        uint16_t room = get_send_buffer_size();
+        if (!room) {
+            return 0;
+        }
+        // 写入与是否输出的判断在同一次tcpip调用中完成
+        lwip_data_t msg = {};
+        msg.pcb = pcb_;
+        msg.client = this;
+        msg.write_apiflag = apiflags & ~TCP_WRITE_FLAG_MORE;
+        msg.write_len = room > size ? size : room;
+        msg.write_data = data;
+        auto err = tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+                ASYNC_PROF_SCOPE(Write);
+                auto* msg = reinterpret_cast<lwip_data_t*>(data);
+                auto* self = msg->client;
+                msg->write_len = self->EgressAllow(msg->write_len);
+                if (msg->write_len == 0) {
+                    return ERR_WOULDBLOCK;
+                }
+                // 未达到阈值的写入不置PSH，达到阈值的最后一次写入由协议栈置PSH
+                size_t threshold = self->cork_threshold_ ? self->cork_threshold_ : tcp_mss(msg->pcb);
+                bool flush = self->corked_bytes_ + msg->write_len >= threshold;
+                auto err = tcp_write(msg->pcb, msg->write_data, msg->write_len,
+                    flush ? msg->write_apiflag : msg->write_apiflag | TCP_WRITE_FLAG_MORE);
+                if (err != ERR_OK) {
+                    return err;
+                }
+                self->egress_.consume(msg->write_len);
+                self->corked_bytes_ += msg->write_len;
+                if (flush) {
+                    self->FlushCork();
+                } else if (!esp_timer_is_active(self->cork_timer_)) {
+                    esp_timer_start_once(self->cork_timer_, self->cork_deadline_us_);
+                }
+                return ERR_OK;
+            },
+            (tcpip_api_call_data*)&msg);
+        return (err != ERR_OK) ? 0 : msg.write_len;
+    }
     auto will_send = add(data, size, apiflags);
     if (!will_send || !send()) {
         return 0;
     }
     return will_send;
 }
+
+
+/// @brief 非阻塞地提交发送数据，可在任意任务中调用。
+/// 数据被复制后放入本连接的发送队列，由tcpip线程按提交顺序写入并发送；
+/// 发送结果通过ACK回调（已确认）或错误回调（连接异常）返回。
+/// 指定header时，header与data合并为同一数据块提交，不会与其他任务提交的数据交错（用于帧头与负载）。
+/// @return 成功放入发送队列时返回true；连接未建立或已释放、排队数据将超过CONFIG_ASYNC_TX_QUEUE_LIMIT时返回false
+bool AsyncClient::write_async(const void* header, size_t header_len, const void* data, size_t size)
+{
+    if (header == nullptr) {
+        header_len = 0;
+    }
+    if (data == nullptr) {
+        size = 0;
+    }
+    size_t len = header_len + size;
+    if (!IsActive() || len == 0) {
+        return false;
+    }
+    // 预留队列额度，超过上限时拒绝
+    if (len > CONFIG_ASYNC_TX_QUEUE_LIMIT) {
+        return false;
+    }
+    if (tx_queued_.fetch_add(len) + len > CONFIG_ASYNC_TX_QUEUE_LIMIT) {
+        tx_queued_ -= len;
+        return false;
+    }
+    auto* mem = new (std::nothrow) uint8_t[sizeof(async_tx_t) + len];
+    if (mem == nullptr) {
+        tx_queued_ -= len;
+        return false;
+    }
+    auto* tx = reinterpret_cast<async_tx_t*>(mem);
+    tx->len = len;
+    tx->offset = 0;
+    auto* payload = reinterpret_cast<uint8_t*>(tx + 1);
+    if (header_len) {
+        memcpy(payload, header, header_len);
+    }
+    if (size) {
+        memcpy(payload + header_len, data, size);
+    }
+
+    // 多生产者入队；连接释放时队列被置为关闭状态，此后提交的数据不再入队
+    auto* head = tx_inbox_.load();
+    do {
+        if (head == &tx_closed_) {
+            tx_queued_ -= len;
+            delete[] mem;
+            return false;
+        }
+        tx->next = head;
+    } while (!tx_inbox_.compare_exchange_weak(head, tx));
+
+    // 若尚无排队的处理请求，则通知tcpip线程；消息队列已满时留待下次ACK或轮询处理
+    if (!tx_drain_pending_.exchange(true)) {
+        if (tcpip_try_callback([](void* arg) {
+                reinterpret_cast<AsyncClient*>(arg)->DrainTx();
+            }, this) != ERR_OK) {
+            tx_drain_pending_ = false;
+        }
+    }
+    return true;
+}
+
+/// @brief 是否存在尚未写入协议栈的异步数据
+bool AsyncClient::HasPendingTx()
+{
+    auto* inbox = tx_inbox_.load();
+    return tx_head_ != nullptr || (inbox != nullptr && inbox != &tx_closed_);
+}
+
+/// @brief 将异步发送队列中的数据写入协议栈并发送（仅在tcpip线程中调用）
+void AsyncClient::DrainTx()
+{
+    tx_drain_pending_ = false;
+
+    // 取出新提交的数据（队列已关闭时保持关闭），恢复提交顺序后接到待发送队列尾部
+    auto* list = tx_inbox_.load();
+    while (list && list != &tx_closed_ && !tx_inbox_.compare_exchange_weak(list, nullptr)) {
+    }
+    if (list == &tx_closed_) {
+        list = nullptr;
+    }
+    async_tx_t* reversed = nullptr;
+    while (list) {
+        auto* next = list->next;
+        list->next = reversed;
+        reversed = list;
+        list = next;
+    }
+    if (reversed) {
+        if (tx_tail_) {
+            tx_tail_->next = reversed;
+        } else {
+            tx_head_ = reversed;
+        }
+        tx_tail_ = reversed;
+        while (tx_tail_->next) {
+            tx_tail_ = tx_tail_->next;
+        }
+    }
+
+    if (!IsActive()) {
+        DropTx();
+        CancelEgress();
+        return;
+    }
+
+    // 服务器设置了总发送带宽时由服务器统一调度，否则直接发送
+    if (server_ && server_->egress_.rate) {
+        server_->EnqueueEgress(this);
+        server_->ScheduleEgress();
+    } else {
+        TransmitTx(SIZE_MAX);
+    }
+}
+
+/// @brief 将待发送队列中不超过limit字节的数据写入协议栈并发送（仅在tcpip线程中调用）
+/// @return 实际写入的字节数
+size_t AsyncClient::TransmitTx(size_t limit)
+{
+    size_t allowed = egress_.refill(SystemInfo::GetMsSinceStart());
+    if (limit > allowed) {
+        limit = allowed;
+    }
+    size_t total = 0;
+    while (tx_head_ && total < limit) {
+        auto* tx = tx_head_;
+        uint16_t room = tcp_sndbuf(pcb_);
+        if (room == 0) {
+            break;
+        }
+        size_t left = tx->len - tx->offset;
+        if (left > limit - total) {
+            left = limit - total;
+        }
+        uint16_t len = room > left ? left : room;
+        auto err = tcp_write(pcb_, reinterpret_cast<uint8_t*>(tx + 1) + tx->offset, len, TCP_WRITE_FLAG_COPY);
+        if (err == ERR_MEM) {
+            break;
+        }
+        if (err != ERR_OK) {
+            // 连接异常，由错误回调通知上层
+            DropTx();
+            break;
+        }
+        total += len;
+        tx->offset += len;
+        tx_queued_ -= len;
+        if (tx->offset == tx->len) {
+            tx_head_ = tx->next;
+            if (tx_head_ == nullptr) {
+                tx_tail_ = nullptr;
+            }
+            delete[] reinterpret_cast<uint8_t*>(tx);
+        }
+    }
+    egress_.consume(total);
+
+    if (total && tcp_output(pcb_) == ERR_OK) {
+        last_tx_timestamp_ = SystemInfo::GetMsSinceStart();
+        last_rx_timestamp_ = last_tx_timestamp_;
+        xEventGroupSetBits(event_group_, ASYNC_TCP_SENDDING_BIT);
+        xEventGroupClearBits(event_group_, ASYNC_TCP_CAN_SEND_BIT);
+    }
+
+    // 令牌耗尽时等待补充后继续发送
+    if (tx_head_ && egress_.rate && egress_.tokens == 0 && !egress_timer_armed_) {
+        egress_timer_armed_ = true;
+        sys_timeout(egress_.wait_ms(TCP_MSS), EgressTimer, this);
+    }
+    return total;
+}
+
+/// @brief 令牌补充定时器（在tcpip线程中运行）
+void AsyncClient::EgressTimer(void* arg)
+{
+    auto* self = reinterpret_cast<AsyncClient*>(arg);
+    self->egress_timer_armed_ = false;
+    if (self->HasPendingTx()) {
+        self->DrainTx();
+    }
+}
+
+/// @brief 获取当前允许直接写入的字节数（仅在tcpip线程中调用）：不超过自身限速令牌；服务器设置了总带宽时不超过剩余总带宽，
+/// 且其他连接在调度环中排队时最多一个轮询额度，使add()/write()/流式发送与排队的连接按轮分享带宽
+uint32_t AsyncClient::EgressRoom()
+{
+    auto now = SystemInfo::GetMsSinceStart();
+    uint32_t room = egress_.refill(now);
+    if (server_ && server_->egress_.rate) {
+        auto budget = server_->egress_.refill(now);
+        room = room < budget ? room : budget;
+        if (server_->tx_ring_size_ > (in_tx_ring_ ? 1u : 0u) && room > server_->egress_quantum_) {
+            room = server_->egress_quantum_;
+        }
+    }
+    return room;
+}
+
+/// @brief 按限速截断本次写入量，同时计入服务器总发送带宽（仅在tcpip线程中调用）
+uint16_t AsyncClient::EgressAllow(uint16_t len)
+{
+    auto room = EgressRoom();
+    if (len > room) {
+        len = room;
+    }
+    if (server_ && server_->egress_.rate) {
+        server_->egress_.consume(len);
+    }
+    return len;
+}
+
+/// @brief 停止等待令牌并移出服务器发送调度环（仅在tcpip线程中调用）
+void AsyncClient::CancelEgress()
+{
+    if (egress_timer_armed_) {
+        sys_untimeout(EgressTimer, this);
+        egress_timer_armed_ = false;
+    }
+    if (in_tx_ring_) {
+        server_->RemoveEgress(this);
+    }
+    deficit_ = 0;
+}
+
+/// @brief 设置发送限速
+void AsyncClient::set_egress_limit(uint32_t bytes_per_sec, uint32_t burst)
+{
+    if (burst == 0) {
+        burst = bytes_per_sec / 10 > TCP_MSS ? bytes_per_sec / 10 : TCP_MSS;
+    }
+    lwip_data_t msg = {};
+    msg.client = this;
+    msg.egress_rate = bytes_per_sec;
+    msg.egress_burst = burst;
+    tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+            auto* msg = reinterpret_cast<lwip_data_t*>(data);
+            auto* self = msg->client;
+            self->egress_.set(msg->egress_rate, msg->egress_burst, SystemInfo::GetMsSinceStart());
+            if (self->egress_timer_armed_) {
+                sys_untimeout(EgressTimer, self);
+                self->egress_timer_armed_ = false;
+            }
+            // 新速率下立即发送已排队的数据
+            if (self->HasPendingTx()) {
+                self->DrainTx();
+            }
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+}
+
+/// @brief 关闭异步发送队列并丢弃所有尚未发送的数据，此后write_async()返回false，直到下一个连接初始化
+void AsyncClient::DropTx()
+{
+    auto* list = tx_inbox_.exchange(&tx_closed_);
+    if (list == &tx_closed_) {
+        list = nullptr;
+    }
+    while (list) {
+        auto* next = list->next;
+        tx_queued_ -= list->len;
+        delete[] reinterpret_cast<uint8_t*>(list);
+        list = next;
+    }
+    while (tx_head_) {
+        auto* next = tx_head_->next;
+        tx_queued_ -= tx_head_->len - tx_head_->offset;
+        delete[] reinterpret_cast<uint8_t*>(tx_head_);
+        tx_head_ = next;
+    }
+    tx_tail_ = nullptr;
+}
+
+/// @brief 上层已处理完接收的数据，向协议栈归还接收窗口（仅在tcpip线程中调用）
+void AsyncClient::AckRx(uint16_t len)
+{
+    if (pcb_ == nullptr) {
+        return;
+    }
+#if CONFIG_ASYNC_RX_AUTOTUNE
+    auto now = SystemInfo::GetMsSinceStart();
+    uint16_t mss = tcp_mss(pcb_);
+    uint32_t rtt = RxRtt();
+
+    // 以上层处理速度计量吞吐量，处理缓慢的连接窗口随之收缩，不再占用过多的pbuf
+    rx_sample_bytes_ += len;
+    uint32_t elapsed = now - rx_sample_start_;
+    if (rx_target_ == 0 || elapsed >= (rtt > ASYNC_RX_MIN_SAMPLE_MS ? rtt : ASYNC_RX_MIN_SAMPLE_MS)) {
+        if (rx_target_ != 0 && elapsed) {
+            uint32_t rate = (uint64_t)rx_sample_bytes_ * 1000 / elapsed;
+            rx_rate_ = rx_rate_ ? (rx_rate_ * 3 + rate) / 4 : rate;
+        }
+        rx_sample_bytes_ = 0;
+        rx_sample_start_ = now;
+        RxRetune(mss, rtt);
+    }
+
+    // 超出目标窗口的部分暂不归还；每次至少归还一个MSS，避免糊涂窗口
+    rx_withheld_ += len;
+    uint32_t keep = TCP_WND > rx_target_ ? TCP_WND - rx_target_ : 0;
+    if (rx_withheld_ >= keep + mss) {
+        // 窗口不足一个MSS时对端只能等待窗口打开，记录打开的时间，新数据到达时得到一个往返时间样本
+        if (rx_probe_start_ == 0 && pcb_->rcv_wnd < mss) {
+            rx_probe_start_ = now ? now : 1;
+        }
+        uint32_t release = rx_withheld_ - keep;
+        rx_withheld_ = keep;
+        while (release) {
+            uint16_t n = release > 0xFFFF ? 0xFFFF : release;
+            tcp_recved(pcb_, n);
+            release -= n;
+        }
+    }
+#else
+    tcp_recved(pcb_, len);
+#endif
+}
+
+#if CONFIG_ASYNC_RX_AUTOTUNE
+/// @brief 获取估算带宽时延积使用的往返时间（毫秒，仅在tcpip线程中调用）
+/// 协议栈对发送数据的平滑往返时间（pcb->sa为8倍平滑值，单位为慢速定时器周期，精度较粗）与
+/// 接收方向的样本（窗口打开至新数据到达，含对端的处理延迟）均有时取较小者；以接收为主的连接协议栈没有样本
+uint32_t AsyncClient::RxRtt()
+{
+    uint32_t stack = pcb_->sa > 0 ? (uint32_t)pcb_->sa * TCP_SLOW_INTERVAL / 8 : 0;
+    uint32_t rtt = rx_srtt_ms_;
+    if (stack && (rtt == 0 || stack < rtt)) {
+        rtt = stack;
+    }
+    return rtt ? rtt : ASYNC_RX_DEFAULT_RTT_MS;
+}
+
+/// @brief 按带宽时延积重新估算目标接收窗口（仅在tcpip线程中调用）
+/// 目标窗口为两倍带宽时延积，使窗口每个往返时间最多翻倍；
+/// 下限为两个MSS与已到达尚未处理的数据量中的较大者（不收缩至正在途中的数据以下），
+/// 上限为TCP_WND，所有连接之和不超过CONFIG_ASYNC_RX_MEM_LIMIT
+void AsyncClient::RxRetune(uint16_t mss, uint32_t rtt)
+{
+    uint32_t floor = 2 * mss < TCP_WND ? 2 * mss : TCP_WND;
+    uint32_t outstanding = TCP_WND > pcb_->rcv_wnd ? TCP_WND - pcb_->rcv_wnd : 0;
+    uint32_t inflight = outstanding > rx_withheld_ ? outstanding - rx_withheld_ : 0;
+    if (inflight > floor) {
+        floor = inflight;
+    }
+    uint32_t want = TCP_WND;
+    if (rx_rate_) {
+        uint64_t bdp = (uint64_t)rx_rate_ * rtt / 1000;
+        want = bdp * 2 < TCP_WND ? bdp * 2 : TCP_WND;
+    }
+    if (want < floor) {
+        want = floor;
+    }
+
+    s_rx_reserved -= rx_target_;
+    uint32_t room = CONFIG_ASYNC_RX_MEM_LIMIT > s_rx_reserved ? CONFIG_ASYNC_RX_MEM_LIMIT - s_rx_reserved : 0;
+    if (want > room) {
+        want = room > floor ? room : floor;
+    }
+    rx_target_ = want;
+    s_rx_reserved += want;
+}
+
+/// @brief 连接关闭，归还占用的窗口额度（仅在tcpip线程中调用）
+void AsyncClient::RxRelease()
+{
+    s_rx_reserved -= rx_target_;
+    rx_target_ = 0;
+    rx_withheld_ = 0;
+}
+#endif
+
+/// @brief 以拉取方式发送数据：数据源按发送缓冲区的可用空间逐段产生数据，
+/// 首次调用时立即填充，此后每当对端确认数据、窗口打开时继续填充，直至数据源报告结束。
+/// 数据源在tcpip线程中调用，不得阻塞，也不得调用本连接的add()/send()/write()/close()等同步接口。
+/// @param producer 数据源，向buf写入不超过len字节并返回写入量；返回0表示暂无数据（在下次轮询时再次调用），数据全部产生后将*eos置为true
+/// @return 连接不可用或已有流式发送未完成时返回false
+bool AsyncClient::send_stream(AcStreamProducer producer, void* arg)
+{
+    if (!IsActive() || producer == nullptr) {
+        return false;
+    }
+    auto mss = get_MSS();
+    auto* stream = static_cast<stream_t*>(::operator new(sizeof(stream_t) + mss, std::nothrow));
+    if (stream == nullptr) {
+        ESP_LOGE(TAG, "流式发送失败：申请暂存区失败");
+        return false;
+    }
+    stream->producer = producer;
+    stream->arg = arg;
+    stream->buf_len = mss;
+    stream->fill = 0;
+    stream->eos = false;
+    lwip_data_t msg = {};
+    msg.client = this;
+    msg.stream = stream;
+    auto err = tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+            auto* msg = reinterpret_cast<lwip_data_t*>(data);
+            auto* self = msg->client;
+            if (self->stream_ || self->pcb_ == nullptr) {
+                return ERR_INPROGRESS;
+            }
+            self->stream_ = msg->stream;
+            self->PumpStream();
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    if (err != ERR_OK) {
+        ::operator delete(stream);
+        return false;
+    }
+    return true;
+}
+
+/// @brief 使用数据源填满当前可用的发送缓冲区，全部写入后统一输出（仅在tcpip线程中调用）
+void AsyncClient::PumpStream()
+{
+    bool queued = false;
+    while (stream_ && pcb_) {
+        auto* stream = stream_;
+        // 暂存区为空时按可用空间产生下一段数据
+        if (stream->fill == 0) {
+            if (stream->eos) {
+                EndStream();
+                break;
+            }
+            size_t room = tcp_sndbuf(pcb_);
+            size_t tokens = EgressRoom();
+            room = room < tokens ? room : tokens;
+            room = room < stream->buf_len ? room : stream->buf_len;
+            if (room == 0) {
+                break;
+            }
+            bool eos = false;
+            stream->fill = stream->producer(stream->arg, stream->buf(), room, &eos);
+            stream->eos = eos;
+            if (stream->fill == 0) {
+                if (eos) {
+                    EndStream();
+                }
+                break;
+            }
+        }
+        if (tcp_sndbuf(pcb_) < stream->fill) {
+            break;
+        }
+        auto err = tcp_write(pcb_, stream->buf(), stream->fill, TCP_WRITE_FLAG_COPY | (stream->eos ? 0 : TCP_WRITE_FLAG_MORE));
+        if (err == ERR_MEM) {
+            break;      // 发送队列已满，暂存的数据在窗口打开后重试
+        }
+        if (err != ERR_OK) {
+            ESP_LOGW(TAG, "流式发送中断：写入发送缓冲区失败");
+            EndStream();
+            break;
+        }
+        EgressAllow(stream->fill);
+        egress_.consume(stream->fill);
+        stream->fill = 0;
+        queued = true;
+    }
+    if (queued && tcp_output(pcb_) == ERR_OK) {
+        last_tx_timestamp_ = SystemInfo::GetMsSinceStart();
+        last_rx_timestamp_ = last_tx_timestamp_;
+        xEventGroupSetBits(event_group_, ASYNC_TCP_SENDDING_BIT);
+        xEventGroupClearBits(event_group_, ASYNC_TCP_CAN_SEND_BIT);
+    }
+}
+
+/// @brief 服务器优雅关闭中，异步数据与流式数据均已写入协议栈后发送FIN（仅在tcpip线程中调用）。
+/// 发送失败（如ERR_MEM）时保持等待，由下次ACK或轮询回调重试
+void AsyncClient::ShutdownWhenDrained()
+{
+    if (!closing_ || pcb_ == nullptr || HasPendingTx() || stream_) {
+        return;
+    }
+    if (pcb_->state != ESTABLISHED && pcb_->state != CLOSE_WAIT && pcb_->state != SYN_RCVD) {
+        return;     // 已发送过FIN
+    }
+    tcp_shutdown(pcb_, 0, 1);
+}
+
+/// @brief 结束流式发送并释放暂存区（仅在tcpip线程中调用）
+void AsyncClient::EndStream()
+{
+    ::operator delete(stream_);
+    stream_ = nullptr;
+}
+
+/// @brief 设置自动合包
+/// @param enable true时启用，false时关闭并立即发送已累积的数据
+/// @param threshold 累积量达到该值时立即发送，0表示使用当前MSS
+/// @param deadline_us 数据最长累积时间（微秒），0表示使用CONFIG_ASYNC_CORK_DEADLINE_US
+void AsyncClient::set_auto_cork(bool enable, uint16_t threshold, uint32_t deadline_us)
+{
+    if (enable && cork_timer_ == nullptr) {
+        esp_timer_create_args_t args = {};
+        args.callback = [](void* arg) {
+            // 在tcpip线程中完成输出；不阻塞定时器任务，消息队列已满时稍后重试
+            if (tcpip_try_callback([](void* arg) {
+                    reinterpret_cast<AsyncClient*>(arg)->FlushCork();
+                }, arg) != ERR_OK) {
+                esp_timer_start_once(reinterpret_cast<AsyncClient*>(arg)->cork_timer_, ASYNC_CORK_RETRY_US);
+            }
+        };
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "TCP Cork";
+        if (esp_timer_create(&args, &cork_timer_) != ESP_OK) {
+            ESP_LOGE(TAG, "创建合包定时器失败");
+            return;
+        }
+    }
+    // 合包参数在tcpip线程中读取，须在同一线程中修改
+    lwip_data_t msg = {};
+    msg.client = this;
+    msg.cork_enable = enable;
+    msg.cork_threshold = threshold;
+    msg.cork_deadline_us = deadline_us ? deadline_us : CONFIG_ASYNC_CORK_DEADLINE_US;
+    tcpip_api_call([](tcpip_api_call_data * data) -> err_t {
+            auto* msg = reinterpret_cast<lwip_data_t*>(data);
+            auto* self = msg->client;
+            self->cork_threshold_ = msg->cork_threshold;
+            self->cork_deadline_us_ = msg->cork_deadline_us;
+            self->auto_cork_ = msg->cork_enable;
+            if (!msg->cork_enable) {
+                self->FlushCork();
+            }
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+}
+
+/// @brief 输出已累积的数据（仅在tcpip线程中调用）
+void AsyncClient::FlushCork()
+{
+    if (cork_timer_) {
+        esp_timer_stop(cork_timer_);
+    }
+    if (!IsActive() || corked_bytes_ == 0) {
+        return;
+    }
+    corked_bytes_ = 0;
+    // 截止时间到达时，已累积的数据均以TCP_WRITE_FLAG_MORE写入，为最后一个报文段补上PSH
+    if (pcb_->unsent) {
+        auto* seg = pcb_->unsent;
+        while (seg->next) {
+            seg = seg->next;
+        }
+        TCPH_SET_FLAG(seg->tcphdr, TCP_PSH);
+    }
+    if (tcp_output(pcb_) == ERR_OK) {
+        last_tx_timestamp_ = SystemInfo::GetMsSinceStart();
+        last_rx_timestamp_ = last_tx_timestamp_;
+        xEventGroupSetBits(event_group_, ASYNC_TCP_SENDDING_BIT);
+        xEventGroupClearBits(event_group_, ASYNC_TCP_CAN_SEND_BIT);
+    }
+}
\ No newline at end of file
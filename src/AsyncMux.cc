@@ -0,0 +1,254 @@
+#include "AsyncMux.h"
+#include "esp_log.h"
+#include <new>
+#include <string.h>
+
+#define TAG "AsyncMux"
+
+static_assert(CONFIG_ASYNC_MUX_MAX_CHANNELS <= 256, "通道号在帧头中占1字节");
+static_assert(CONFIG_ASYNC_MUX_MAX_FRAME <= 0xFFFF, "帧长度在帧头中占2字节");
+static_assert(CONFIG_ASYNC_MUX_MAX_FRAME >= 4, "CREDIT帧的负载为4字节");
+
+AsyncMux::AsyncMux(AsyncClient* client, bool initiator)
+    : client_(client), initiator_(initiator)
+{
+    rx_buf_ = new (std::nothrow) uint8_t[CONFIG_ASYNC_MUX_MAX_FRAME];
+    if (rx_buf_ == nullptr) {
+        ESP_LOGE(TAG, "申请帧暂存区失败");
+    }
+    client_->set_data_received_handler([](void* arg, void* data, size_t len) {
+            reinterpret_cast<AsyncMux*>(arg)->feed(data, len);
+        }, this);
+    client_->set_disconnected_event_handler([](void* arg) {
+            reinterpret_cast<AsyncMux*>(arg)->CloseAll();
+        }, this);
+    client_->set_error_event_handler([](void* arg, err_t) {
+            reinterpret_cast<AsyncMux*>(arg)->CloseAll();
+        }, this);
+}
+
+AsyncMux::~AsyncMux()
+{
+    client_->set_data_received_handler(nullptr);
+    client_->set_disconnected_event_handler(nullptr);
+    client_->set_error_event_handler(nullptr);
+    delete[] rx_buf_;
+}
+
+/// @brief 打开一个通道
+/// @return 通道号，无空闲通道或发送失败时返回-1
+int AsyncMux::open()
+{
+    for (unsigned ch = initiator_ ? 1 : 2; ch < CONFIG_ASYNC_MUX_MAX_CHANNELS; ch += 2) {
+        auto& channel = channels_[ch];
+        if (channel.open.exchange(true)) {
+            continue;
+        }
+        channel.tx_credit = CONFIG_ASYNC_MUX_WINDOW;
+        channel.rx_consumed = 0;
+        if (!SendFrame(FRAME_OPEN, ch, nullptr, 0)) {
+            channel.open = false;
+            return -1;
+        }
+        return ch;
+    }
+    return -1;
+}
+
+/// @brief 关闭通道，对端收到后触发其关闭回调；本端不会触发关闭回调
+bool AsyncMux::close(uint8_t channel)
+{
+    if (!is_open(channel)) {
+        return false;
+    }
+    Reset(channel);
+    return SendFrame(FRAME_CLOSE, channel, nullptr, 0);
+}
+
+/// @brief 向通道发送数据，受通道发送额度限制
+/// @return 实际提交的字节数，额度不足时小于len，额度耗尽时为0（等待额度归还回调后重试）
+size_t AsyncMux::write(uint8_t channel, const void* data, size_t len)
+{
+    if (!is_open(channel) || data == nullptr || len == 0) {
+        return 0;
+    }
+    // 预留额度
+    auto& credit = channels_[channel].tx_credit;
+    uint32_t avail = credit.load();
+    uint32_t take;
+    do {
+        take = len < avail ? len : avail;
+        if (take == 0) {
+            return 0;
+        }
+    } while (!credit.compare_exchange_weak(avail, avail - take));
+
+    auto* p = reinterpret_cast<const uint8_t*>(data);
+    size_t sent = 0;
+    while (sent < take) {
+        size_t n = take - sent;
+        if (n > CONFIG_ASYNC_MUX_MAX_FRAME) {
+            n = CONFIG_ASYNC_MUX_MAX_FRAME;
+        }
+        if (!SendFrame(FRAME_DATA, channel, p + sent, n)) {
+            break;
+        }
+        sent += n;
+    }
+    // 归还未能提交部分的额度
+    if (sent < take) {
+        credit += take - sent;
+    }
+    return sent;
+}
+
+/// @brief 输入从连接接收的数据，按帧重组后分发至各通道
+void AsyncMux::feed(const void* data, size_t len)
+{
+    auto* p = reinterpret_cast<const uint8_t*>(data);
+    while (len) {
+        // 帧头
+        if (rx_header_len_ < FRAME_HEADER_LEN) {
+            size_t n = FRAME_HEADER_LEN - rx_header_len_;
+            n = n < len ? n : len;
+            memcpy(rx_header_ + rx_header_len_, p, n);
+            rx_header_len_ += n;
+            p += n;
+            len -= n;
+            if (rx_header_len_ < FRAME_HEADER_LEN) {
+                return;
+            }
+            rx_len_ = (rx_header_[2] << 8) | rx_header_[3];
+            rx_got_ = 0;
+            if (rx_len_ > CONFIG_ASYNC_MUX_MAX_FRAME || rx_buf_ == nullptr) {
+                ESP_LOGW(TAG, "帧长度%u超出限制，关闭连接", rx_len_);
+                rx_header_len_ = 0;
+                CloseAll();
+                client_->close();
+                return;
+            }
+            if (rx_len_ == 0) {
+                rx_header_len_ = 0;
+                Dispatch(rx_header_[0], rx_header_[1], nullptr, 0);
+                continue;
+            }
+        }
+        // 负载完整位于本次数据中时直接分发，否则先暂存
+        if (rx_got_ == 0 && len >= rx_len_) {
+            rx_header_len_ = 0;
+            Dispatch(rx_header_[0], rx_header_[1], p, rx_len_);
+            p += rx_len_;
+            len -= rx_len_;
+            continue;
+        }
+        size_t n = rx_len_ - rx_got_;
+        n = n < len ? n : len;
+        memcpy(rx_buf_ + rx_got_, p, n);
+        rx_got_ += n;
+        p += n;
+        len -= n;
+        if (rx_got_ == rx_len_) {
+            rx_header_len_ = 0;
+            Dispatch(rx_header_[0], rx_header_[1], rx_buf_, rx_len_);
+        }
+    }
+}
+
+/// @brief 处理一个完整的帧
+void AsyncMux::Dispatch(uint8_t type, uint8_t ch, const uint8_t* payload, uint16_t len)
+{
+    if (ch == 0 || !valid(ch)) {
+        return;
+    }
+    auto& channel = channels_[ch];
+    switch (type) {
+    case FRAME_OPEN:
+        // 对端只能打开其自身奇偶性的通道，与本端通道奇偶性相同的打开请求违反约定，忽略且不回复关闭（以免关闭本端的同号通道）
+        if ((ch & 1) == (initiator_ ? 1 : 0)) {
+            ESP_LOGW(TAG, "对端打开了本端的通道%u，已忽略", ch);
+            break;
+        }
+        if (!channel.open.load() && on_open_handler_) {
+            channel.tx_credit = CONFIG_ASYNC_MUX_WINDOW;
+            channel.rx_consumed = 0;
+            channel.open = true;
+            if (on_open_handler_(on_open_arg_, this, ch)) {
+                break;
+            }
+            Reset(ch);
+        }
+        SendFrame(FRAME_CLOSE, ch, nullptr, 0);
+        break;
+    case FRAME_DATA:
+        if (!channel.open.load()) {
+            break;
+        }
+        if (channel.on_data_handler) {
+            channel.on_data_handler(channel.on_data_arg, const_cast<uint8_t*>(payload), len);
+        }
+        // 处理完成后累计归还额度，达到窗口一半时通知对端，避免频繁发送小的控制帧
+        channel.rx_consumed += len;
+        if (channel.rx_consumed >= CONFIG_ASYNC_MUX_WINDOW / 2 && channel.open.load()) {
+            uint8_t credit[4] = {
+                (uint8_t)(channel.rx_consumed >> 24), (uint8_t)(channel.rx_consumed >> 16),
+                (uint8_t)(channel.rx_consumed >> 8), (uint8_t)channel.rx_consumed
+            };
+            if (SendFrame(FRAME_CREDIT, ch, credit, sizeof(credit))) {
+                channel.rx_consumed = 0;
+            }
+        }
+        break;
+    case FRAME_CLOSE:
+        if (channel.open.load()) {
+            Reset(ch);
+            if (channel.on_close_handler) {
+                channel.on_close_handler(channel.on_close_arg);
+            }
+        }
+        break;
+    case FRAME_CREDIT:
+        if (channel.open.load() && len == 4) {
+            uint32_t credit = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) | (payload[2] << 8) | payload[3];
+            auto now = channel.tx_credit += credit;
+            if (channel.on_credit_handler) {
+                channel.on_credit_handler(channel.on_credit_arg, now);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/// @brief 发送一帧，帧头与负载作为一个整体提交，多个任务同时发送时不会交错
+/// @return 负载超过CONFIG_ASYNC_MUX_MAX_FRAME或提交失败时返回false
+bool AsyncMux::SendFrame(uint8_t type, uint8_t channel, const void* data, size_t len)
+{
+    if (len > CONFIG_ASYNC_MUX_MAX_FRAME) {
+        return false;
+    }
+    uint8_t header[FRAME_HEADER_LEN] = { type, channel, (uint8_t)(len >> 8), (uint8_t)len };
+    return client_->write_async(header, sizeof(header), data, len);
+}
+
+/// @brief 将通道恢复为关闭状态
+void AsyncMux::Reset(uint8_t channel)
+{
+    channels_[channel].open = false;
+    channels_[channel].tx_credit = 0;
+    channels_[channel].rx_consumed = 0;
+}
+
+/// @brief 连接断开，关闭所有通道
+void AsyncMux::CloseAll()
+{
+    for (unsigned ch = 1; ch < CONFIG_ASYNC_MUX_MAX_CHANNELS; ch++) {
+        auto& channel = channels_[ch];
+        if (channel.open.exchange(false)) {
+            Reset(ch);
+            if (channel.on_close_handler) {
+                channel.on_close_handler(channel.on_close_arg);
+            }
+        }
+    }
+}
@@ -1,15 +1,17 @@
 #include "AsyncServer.h"
 #include "esp_log.h"
 #include "lwip/tcp.h"
+#include "lwip/timeouts.h"
+#include "my_sysInfo.h"
 #include "async.h"
+#include "AsyncProfile.h"
 
 #define TAG "AsyncServer"
+#define ASYNC_TEARDOWN_BATCH    16      // 批量关闭时每次tcpip调用处理的连接数
 
 AsyncServer::AsyncServer(ip_addr_t addr, uint16_t port)
-    : port_(port)
-    , addr_(addr)
-    , bg_(MyBackground::GetInstance())
 {
+    add_listener(addr, port);
     recycleTimer_ = xTimerCreate(
         "TCP Clean Timer",
         pdMS_TO_TICKS(1000 * 30),       // 30s清理1次
@@ -29,55 +31,92 @@ void AsyncServer::Clean(bool clean_all)
         on_clean_handler_(on_clean_arg_);
     }
 
-    // 清理本层资源
-    auto* head = pool_.exchange(nullptr);
-    if (head != nullptr) {
-        auto* current = head->next_;
-        while (current) {
-            auto* next = current->next_;
-            delete current;
-            current = next;
-        }
-        head->next_ = nullptr;
-        if (!clean_all) {
-            recycleClient(head);
-            ESP_LOGI(TAG, "连接已被清理.");
+    // 清理本层资源：在tcpip线程中取出空闲连接，与接入时的分配串行执行，避免释放正被读取的连接
+    tcpip_clean_data_t msg = {
+        .data = nullptr,
+        .pool = &pool_,
+        .list = nullptr
+    };
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<tcpip_clean_data_t*>(data);
+            msg->list = msg->pool->take_all();
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    // 每个监听端口保留一个连接用于快速接入
+    auto* current = msg.list;
+    uint8_t kept = 0;
+    while (current) {
+        auto* next = current->next_;
+        if (!clean_all && kept < listener_count_) {
+            recycleClient(current);
+            kept++;
         } else {
-            delete head;
-            ESP_LOGI(TAG, "连接已被清理完毕.");
+            delete current;
+            allocated_--;
         }
+        current = next;
+    }
+    if (msg.list) {
+        ESP_LOGI(TAG, clean_all ? "连接已被清理完毕." : "连接已被清理.");
+    }
+}
+
+/// @brief 添加监听端口（须在begin()之前调用）。所有端口共享同一连接池与事件分发。
+/// @param profile 该端口接入连接使用的回调表，为空时使用set_client_profile()设置的回调表
+/// @param max_clients 该端口最大连接数，0表示不限制
+/// @return 监听端口编号（即AsyncClient::get_listener_id()），失败时返回-1
+int AsyncServer::add_listener(ip_addr_t addr, uint16_t port, const AsyncClientProfile* profile, uint16_t max_clients)
+{
+    if (listener_count_ >= CONFIG_SERVER_MAX_LISTENERS) {
+        ESP_LOGE(TAG, "添加监听失败：监听端口数量已达上限");
+        return -1;
     }
+    auto& listener = listeners_[listener_count_];
+    listener.server = this;
+    listener.id = listener_count_;
+    listener.pcb = nullptr;
+    listener.addr = addr;
+    listener.port = port;
+    listener.max_clients = max_clients;
+    listener.clients = 0;
+    listener.profile = profile;
+    return listener_count_++;
 }
 
-/// @brief 启动TCP服务器
+/// @brief 启动TCP服务器，开始监听所有已添加的端口
 void AsyncServer::begin()
 {
-    if (pcb_) {
+    recycleClient(newClient());
+    for (uint8_t i = 0; i < listener_count_; i++) {
+        listen(listeners_[i]);
+    }
+}
+
+/// @brief 启动单个端口的监听
+void AsyncServer::listen(listener_t& listener)
+{
+    if (listener.pcb) {
         ESP_LOGE(TAG, "启动错误：协议控制块PCB不为空");
         return;
     }
 
-    pcb_ = tcp_new_ip_type(IPADDR_TYPE_V4);
-    if (!pcb_) {
+    listener.pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!listener.pcb) {
         ESP_LOGE(TAG, "启动失败：创建控制块PCB失败");
         return;
     }
 
-    if (bind() != ERR_OK) {
-        abort_tcp(pcb_);           
-        pcb_ = nullptr;            
+    if (bind(listener) != ERR_OK) {
+        abort_tcp(listener.pcb);
+        listener.pcb = nullptr;
         ESP_LOGE(TAG, "启动失败：PCB绑定IP、Port时出错");
         return;
     }
 
-    
-    recycleClient(new AsyncClient());
-
-
-
     tcpip_listen_data_t msg = {
         .data = nullptr,
-        .pcb = pcb_,
+        .pcb = listener.pcb,
         .listen_backlog = CONFIG_SERVER_BACKLOG_LEN
     };
     tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
@@ -86,56 +125,137 @@ void AsyncServer::begin()
             return ERR_OK;
         },
         (tcpip_api_call_data*)&msg);
-    pcb_ = msg.pcb;
+    listener.pcb = msg.pcb;
 
-    tcp_arg(pcb_, this);
-    tcp_accept(pcb_, [](void* arg, tcp_pcb* pcb, err_t err) -> err_t {
+    tcp_arg(listener.pcb, &listener);
+    tcp_accept(listener.pcb, [](void* arg, tcp_pcb* pcb, err_t err) -> err_t {
         if (err != ESP_OK || pcb == nullptr) {
             ESP_LOGE(TAG, "连接错误，err=%s", esp_err_to_name(err));
             tcp_abort(pcb);
             return ERR_ABRT;
         }
-        auto* this_ = reinterpret_cast<AsyncServer*>(arg);
-        auto* client = this_->allocateClient(pcb);
+        auto* listener = reinterpret_cast<listener_t*>(arg);
+        auto* this_ = listener->server;
+        if (listener->max_clients && listener->clients.load() >= listener->max_clients) {
+            this_->rejected_++;
+            ESP_LOGW(TAG, "端口%u连接数已达上限，拒绝连接", listener->port);
+            tcp_abort(pcb);
+            return ERR_ABRT;
+        }
+        auto* client = this_->allocateClient(pcb, listener->id);
+        this_->accepted_++;
         client->set_nodelay(this_->nodelay_);
 
         if (this_->on_connected_handler_) {
-            auto ok = this_->bg_.Schedule([](void* arg) {
+            // 接入事件计入连接的事件数，处理完成前连接不会被回收或清理
+            client->events_++;
+            auto ok = async_schedule(AsyncPriority::Control, [](void* arg) {
                     auto* client = reinterpret_cast<AsyncClient*>(arg);
                     auto* server = client->server_;
                     server->on_connected_handler_(server->on_connected_arg_, client);
-                },"Arrived Event", client);
-            if (!ok) { 
+                }, client,
+                [](void* arg) {
+                    auto* client = reinterpret_cast<AsyncClient*>(arg);
+                    client->events_--;
+                    client->ops_->recycle(client);
+                });
+            if (!ok) {
+                // 注销已注册的回调后中断连接，连接只在此处归还一次；返回ERR_ABRT告知协议栈pcb已释放
+                client->events_--;
+                this_->rejected_++;
                 ESP_LOGE(TAG, "Failed to add connected fun to background.");
-                this_->recycleClient(client);
-                return ESP_FAIL;
+                tcp_arg(pcb, nullptr);
+                tcp_err(pcb, nullptr);
+                tcp_recv(pcb, nullptr);
+                tcp_sent(pcb, nullptr);
+                tcp_poll(pcb, nullptr, 0);
+                client->pcb_ = nullptr;
+                this_->untrackClient(client);
+                this_->releaseClient(client);
+                tcp_abort(pcb);
+                return ERR_ABRT;
             }
         }
-        return ESP_OK;
+        return ERR_OK;
     });
 }
 
-/// @brief 关闭服务器连
+/// @brief 关闭服务器所有监听端口
 void AsyncServer::end()
 {
-    if (pcb_) {
-        tcp_accept(pcb_, nullptr);
-        tcp_arg(pcb_, nullptr);
-        if (close_tcp(pcb_) != ESP_OK) {
-            abort_tcp(pcb_);
+    for (uint8_t i = 0; i < listener_count_; i++) {
+        auto& listener = listeners_[i];
+        if (listener.pcb) {
+            tcp_accept(listener.pcb, nullptr);
+            tcp_arg(listener.pcb, nullptr);
+            if (close_tcp(listener.pcb) != ESP_OK) {
+                abort_tcp(listener.pcb);
+            }
+            listener.pcb = nullptr;
         }
-        pcb_ = nullptr;
     }
 }
 
+/// @brief 关闭服务器：停止监听，并按指定方式关闭所有在线连接
+/// @param mode 关闭方式
+/// @param deadline_ms 优雅关闭的最长等待时间，超时后强制断开剩余连接；0表示使用CONFIG_ASYNC_MAX_ACK_TIME
+/// @param on_done 所有连接均已回收后的回调（在回收连接的任务中调用）
+void AsyncServer::end(AsyncShutdownMode mode, uint32_t deadline_ms, AcShutdownHandler on_done, void* arg)
+{
+    end();
+    if (mode == AsyncShutdownMode::ListenOnly) {
+        if (on_done) {
+            on_done(arg);
+        }
+        return;
+    }
+
+    on_shutdown_handler_ = on_done;
+    on_shutdown_arg_ = arg;
+    if (live_count_.load() == 0) {
+        if (on_done) {
+            on_done(arg);
+        }
+        return;
+    }
+    shutting_down_ = true;
+    if (live_count_.load() == 0 && shutting_down_.exchange(false)) {
+        if (on_done) {
+            on_done(arg);
+        }
+        return;
+    }
+
+    if (mode == AsyncShutdownMode::Immediate) {
+        Teardown(true);
+        return;
+    }
+
+    if (shutdownTimer_ == nullptr) {
+        shutdownTimer_ = xTimerCreate(
+            "TCP Shutdown Timer",
+            1,
+            pdFALSE,
+            (void*) this,
+            [](TimerHandle_t xTimer) {
+                auto* self = reinterpret_cast<AsyncServer*>(pvTimerGetTimerID(xTimer));
+                ESP_LOGW(TAG, "优雅关闭超时，强制断开剩余%u个连接", (unsigned)self->live_count_.load());
+                self->Teardown(true);
+            }
+        );
+    }
+    xTimerChangePeriod(shutdownTimer_, pdMS_TO_TICKS(deadline_ms ? deadline_ms : CONFIG_ASYNC_MAX_ACK_TIME), 0);
+    Teardown(false);
+}
+
 /// 将IP/Port关联至PCB
-err_t AsyncServer::bind()
+err_t AsyncServer::bind(listener_t& listener)
 {
     tcpip_bind_data_t msg = {
         .data = nullptr,
-        .pcb = pcb_,
-        .addr = &addr_,
-        .port = port_
+        .pcb = listener.pcb,
+        .addr = &listener.addr,
+        .port = listener.port
     };
     return tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
         auto* msg = reinterpret_cast<tcpip_bind_data_t*>(data);
@@ -144,23 +264,264 @@ err_t AsyncServer::bind()
         (tcpip_api_call_data*)&msg);
 }
 
-/// @brief 向连接池申请连接
+/// @brief 向连接池申请连接（仅在tcpip线程中调用，连接池只允许该线程取出）
 /// @param pcb 关联的pcb
-AsyncClient* AsyncServer::allocateClient(tcp_pcb* pcb)
+/// @param listener 接入的监听端口编号
+AsyncClient* AsyncServer::allocateClient(tcp_pcb* pcb, uint8_t listener)
+{
+    ASYNC_PROF_SCOPE(Allocate);
+    auto* client = pool_.pop();
+    if (!client) {
+        client = newClient();
+    }
+
+    auto& from = listeners_[listener];
+    from.clients++;
+    xTimerReset(recycleTimer_, 0);
+    client->init(this, pcb, from.profile ? from.profile : client_profile_);
+    client->listener_ = listener;
+    trackClient(client);
+    return client;
+}
+
+/// @brief 连接结束后归还连接池，并更新来源端口的连接数
+void AsyncServer::releaseClient(AsyncClient* c)
 {
-    AsyncClient* client;
-    AsyncClient* expected;
+    listeners_[c->listener_].clients--;
+    recycleClient(c);
+    recycled_++;
+
+    // 关闭过程中最后一个连接回收后通知上层
+    if (shutting_down_.load() && live_count_.load() == 0 && shutting_down_.exchange(false)) {
+        if (shutdownTimer_) {
+            xTimerStop(shutdownTimer_, 0);
+        }
+        if (on_shutdown_handler_) {
+            on_shutdown_handler_(on_shutdown_arg_);
+        }
+    }
+}
+
+/// @brief 加入在线连接表
+void AsyncServer::trackClient(AsyncClient* c)
+{
+    taskENTER_CRITICAL(&live_lock_);
+    c->live_prev_ = nullptr;
+    c->live_next_ = live_;
+    if (live_) {
+        live_->live_prev_ = c;
+    }
+    live_ = c;
+    live_count_++;
+    taskEXIT_CRITICAL(&live_lock_);
+}
 
+/// @brief 移出在线连接表
+void AsyncServer::untrackClient(AsyncClient* c)
+{
+    taskENTER_CRITICAL(&live_lock_);
+    if (c->live_prev_) {
+        c->live_prev_->live_next_ = c->live_next_;
+    } else {
+        live_ = c->live_next_;
+    }
+    if (c->live_next_) {
+        c->live_next_->live_prev_ = c->live_prev_;
+    }
+    // 正在分批关闭时，跳过即将移出的连接
+    for (auto*& cursor : teardown_cursor_) {
+        if (cursor == c) {
+            cursor = c->live_next_;
+        }
+    }
+    c->live_prev_ = nullptr;
+    c->live_next_ = nullptr;
+    live_count_--;
+    taskEXIT_CRITICAL(&live_lock_);
+}
+
+/// @brief 分批关闭所有在线连接，每批在一次tcpip调用中完成
+/// @param abort true时强制断开，false时发出待发送数据后发送FIN
+void AsyncServer::Teardown(bool abort)
+{
+    tcpip_teardown_data_t msg = {
+        .data = nullptr,
+        .server = this,
+        .abort = abort,
+        .first = true,
+        .more = false
+    };
     do {
-        expected = pool_.load();
-        if (!expected) {
-            client = new AsyncClient();
+        tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+                auto* msg = reinterpret_cast<tcpip_teardown_data_t*>(data);
+                msg->more = msg->server->TeardownBatch(msg->abort, msg->first);
+                msg->first = false;
+                return ERR_OK;
+            },
+            (tcpip_api_call_data*)&msg);
+    } while (msg.more);
+}
+
+/// @brief 从游标处关闭一批在线连接（仅在tcpip线程中调用）。
+/// 游标在批次之间保留，移出在线表的连接由untrackClient()跳过，每个连接在一次关闭中只处理一次
+/// @param first true时从在线表头开始
+/// @return 在线表中仍有未处理的连接时返回true
+bool AsyncServer::TeardownBatch(bool abort, bool first)
+{
+    AsyncClient* batch[ASYNC_TEARDOWN_BATCH];
+    size_t count = 0;
+
+    // 连接移出在线表后才会释放pcb，因此在本次tcpip调用中取到的pcb均有效
+    taskENTER_CRITICAL(&live_lock_);
+    auto*& cursor = teardown_cursor_[abort ? 1 : 0];
+    if (first) {
+        cursor = live_;
+    }
+    for (; cursor && count < ASYNC_TEARDOWN_BATCH; cursor = cursor->live_next_) {
+        auto* c = cursor;
+        if (c->pcb_ == nullptr || (!abort && c->closing_)) {
+            continue;       // 已断开或已在等待发送FIN
+        }
+        batch[count++] = c;
+    }
+    bool more = cursor != nullptr;
+    taskEXIT_CRITICAL(&live_lock_);
+
+    for (size_t i = 0; i < count; i++) {
+        auto* c = batch[i];
+        if (abort) {
+            // 回调仍注册时由错误回调置空pcb_，否则在此置空，避免回收时再次释放
+            tcp_abort(c->pcb_);
+            c->pcb_ = nullptr;
+        } else {
+            // 先发出已提交的数据，FIN在异步数据与流式数据全部写入协议栈后由ACK/轮询回调发送
+            c->closing_ = true;
+            if (c->HasPendingTx()) {
+                c->DrainTx();
+            }
+            c->FlushCork();
+            c->ShutdownWhenDrained();
+        }
+    }
+    return more;
+}
+
+/// @brief 设置服务器总发送带宽
+void AsyncServer::set_egress_budget(uint32_t bytes_per_sec, uint16_t quantum)
+{
+    tcpip_egress_data_t msg = {
+        .data = nullptr,
+        .server = this,
+        .rate = bytes_per_sec,
+        .quantum = quantum ? quantum : (uint16_t)TCP_MSS
+    };
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<tcpip_egress_data_t*>(data);
+            auto* self = msg->server;
+            uint32_t burst = msg->rate / 10 > msg->quantum ? msg->rate / 10 : msg->quantum;
+            self->egress_.set(msg->rate, burst, SystemInfo::GetMsSinceStart());
+            self->egress_quantum_ = msg->quantum;
+            if (self->egress_timer_armed_) {
+                sys_untimeout(EgressTimer, self);
+                self->egress_timer_armed_ = false;
+            }
+            if (msg->rate) {
+                self->ScheduleEgress();
+                return ERR_OK;
+            }
+            // 取消调度，调度环中的连接恢复自行发送
+            while (self->tx_ring_) {
+                auto* c = self->tx_ring_->tx_ring_next_;
+                self->RemoveEgress(c);
+                if (c->IsActive()) {
+                    c->TransmitTx(SIZE_MAX);
+                }
+            }
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+}
+
+/// @brief 将有待发送数据的连接加入调度环尾部（仅在tcpip线程中调用）
+void AsyncServer::EnqueueEgress(AsyncClient* c)
+{
+    if (c->in_tx_ring_ || c->tx_head_ == nullptr) {
+        return;
+    }
+    c->in_tx_ring_ = true;
+    c->deficit_ = 0;
+    if (tx_ring_ == nullptr) {
+        c->tx_ring_next_ = c;
+    } else {
+        c->tx_ring_next_ = tx_ring_->tx_ring_next_;
+        tx_ring_->tx_ring_next_ = c;
+    }
+    tx_ring_ = c;
+    tx_ring_size_++;
+}
+
+/// @brief 将连接移出调度环（仅在tcpip线程中调用）
+void AsyncServer::RemoveEgress(AsyncClient* c)
+{
+    if (!c->in_tx_ring_) {
+        return;
+    }
+    auto* prev = tx_ring_;
+    while (prev->tx_ring_next_ != c) {
+        prev = prev->tx_ring_next_;
+    }
+    if (prev == c) {
+        tx_ring_ = nullptr;
+    } else {
+        prev->tx_ring_next_ = c->tx_ring_next_;
+        if (tx_ring_ == c) {
+            tx_ring_ = prev;
+        }
+    }
+    c->tx_ring_next_ = nullptr;
+    c->in_tx_ring_ = false;
+    c->deficit_ = 0;
+    tx_ring_size_--;
+}
+
+/// @brief 按差额轮询在调度环中的连接间分配总发送带宽（仅在tcpip线程中调用）
+/// 每轮为连接补充一个额度，连接最多发送累计额度；发送窗口或自身限速暂时阻塞的连接保留一个额度等待下次调度
+void AsyncServer::ScheduleEgress()
+{
+    auto now = SystemInfo::GetMsSinceStart();
+    size_t idle = 0;
+    while (tx_ring_ && idle < tx_ring_size_) {
+        auto budget = egress_.refill(now);
+        if (budget == 0) {
             break;
         }
-        client = expected;
-    } while (! pool_.compare_exchange_weak(expected, client->next_));
+        auto* c = tx_ring_->tx_ring_next_;
+        c->deficit_ += egress_quantum_;
+        auto sent = c->TransmitTx(c->deficit_ < budget ? c->deficit_ : budget);
+        egress_.consume(sent);
+        idle = sent ? 0 : idle + 1;
+        if (c->tx_head_ == nullptr || !c->IsActive()) {
+            RemoveEgress(c);
+            continue;
+        }
+        c->deficit_ -= sent;
+        if (c->deficit_ > egress_quantum_) {
+            c->deficit_ = egress_quantum_;
+        }
+        tx_ring_ = c;
+    }
 
-    xTimerReset(recycleTimer_, 0);
-    client->init(this, pcb);
-    return client;
+    // 总带宽耗尽时等待补充后继续调度，其余情况由ACK、轮询或连接自身的限速定时器驱动
+    if (tx_ring_ && egress_.rate && egress_.tokens == 0 && !egress_timer_armed_) {
+        egress_timer_armed_ = true;
+        sys_timeout(egress_.wait_ms(egress_quantum_), EgressTimer, this);
+    }
+}
+
+/// @brief 总带宽令牌补充定时器（在tcpip线程中运行）
+void AsyncServer::EgressTimer(void* arg)
+{
+    auto* self = reinterpret_cast<AsyncServer*>(arg);
+    self->egress_timer_armed_ = false;
+    self->ScheduleEgress();
 }
@@ -2,8 +2,13 @@
 #include "lwip/tcp.h"
 #include "lwip/priv/tcpip_priv.h"
 #include "esp_log.h"
+#include "my_background.h"
+#include "AsyncProfile.h"
+#include <atomic>
 
 #define TAG "Async"
+#define ASYNC_PRIORITY_NUM  3       // 优先级数量
+#define ASYNC_DRAIN_BATCH   8       // 单次后台任务最多处理的事件数，超出后让出后台线程
 
 struct abort_data_t {
     tcpip_api_call_data*    data;
@@ -45,4 +50,150 @@ err_t close_tcp(tcp_pcb* pcb)
         (tcpip_api_call_data*)&msg);
 
     return err;
+}
+
+struct async_job_t {
+    async_job_t*    next;
+    AsyncJobFn      fn;
+    AsyncJobFn      cleanup;
+    void*           arg;
+    AsyncPriority   prio;
+};
+
+struct async_queue_t {
+    async_job_t*    head;
+    async_job_t*    tail;
+};
+
+static async_queue_t        s_queues[ASYNC_PRIORITY_NUM];
+static portMUX_TYPE         s_queue_lock = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<bool>    s_drain_scheduled{false};
+static std::atomic<size_t>  s_pending{0};
+
+/// @brief 取出优先级最高的事件
+static async_job_t* pop_job()
+{
+    async_job_t* job = nullptr;
+    taskENTER_CRITICAL(&s_queue_lock);
+    for (auto& queue : s_queues) {
+        if (queue.head) {
+            job = queue.head;
+            queue.head = job->next;
+            if (!queue.head) {
+                queue.tail = nullptr;
+            }
+            s_pending--;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_queue_lock);
+    return job;
+}
+
+static void push_job(async_job_t* job)
+{
+    auto& queue = s_queues[static_cast<uint8_t>(job->prio)];
+    taskENTER_CRITICAL(&s_queue_lock);
+    if (queue.tail) {
+        queue.tail->next = job;
+    } else {
+        queue.head = job;
+    }
+    queue.tail = job;
+    s_pending++;
+    taskEXIT_CRITICAL(&s_queue_lock);
+}
+
+/// @brief 将尚未执行的事件移出队列
+/// @return 事件仍在队列中时返回true
+static bool remove_job(async_job_t* job)
+{
+    auto& queue = s_queues[static_cast<uint8_t>(job->prio)];
+    bool found = false;
+    taskENTER_CRITICAL(&s_queue_lock);
+    async_job_t* prev = nullptr;
+    for (auto* current = queue.head; current; prev = current, current = current->next) {
+        if (current == job) {
+            if (prev) {
+                prev->next = current->next;
+            } else {
+                queue.head = current->next;
+            }
+            if (queue.tail == current) {
+                queue.tail = prev;
+            }
+            s_pending--;
+            found = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_queue_lock);
+    return found;
+}
+
+static bool has_job()
+{
+    taskENTER_CRITICAL(&s_queue_lock);
+    bool pending = s_queues[0].head || s_queues[1].head || s_queues[2].head;
+    taskEXIT_CRITICAL(&s_queue_lock);
+    return pending;
+}
+
+static bool kick_drain();
+
+/// @brief 按优先级处理排队的事件
+static void drain_jobs(void*)
+{
+    for (int i = 0; i < ASYNC_DRAIN_BATCH; i++) {
+        auto* job = pop_job();
+        if (!job) {
+            break;
+        }
+        ASYNC_PROF_SCOPE(EventRun);
+        job->fn(job->arg);
+        if (job->cleanup) {
+            job->cleanup(job->arg);
+        }
+        delete job;
+    }
+    s_drain_scheduled = false;
+    if (has_job() && !kick_drain()) {
+        ESP_LOGE(TAG, "Failed to reschedule async dispatch.");
+    }
+}
+
+/// @brief 确保后台存在一个处理任务
+static bool kick_drain()
+{
+    if (s_drain_scheduled.exchange(true)) {
+        return true;
+    }
+    if (!MyBackground::GetInstance().Schedule(drain_jobs, "Async Dispatch", nullptr)) {
+        s_drain_scheduled = false;
+        return false;
+    }
+    return true;
+}
+
+/// @brief 按优先级将事件提交至后台执行
+/// @param prio 事件优先级，同一优先级内保持先进先出
+/// @param fn 事件处理函数
+/// @param cleanup 事件处理完成后的清理函数
+/// @return 提交失败时返回false，此时fn与cleanup均不会被调用
+bool async_schedule(AsyncPriority prio, AsyncJobFn fn, void* arg, AsyncJobFn cleanup)
+{
+    ASYNC_PROF_SCOPE(Schedule);
+    auto* job = new async_job_t{nullptr, fn, cleanup, arg, prio};
+    push_job(job);
+    if (!kick_drain() && remove_job(job)) {
+        delete job;
+        return false;
+    }
+    return true;
+}
+
+/// @brief 获取排队等待处理的事件数
+size_t async_pending()
+{
+    return s_pending.load();
 }
\ No newline at end of file
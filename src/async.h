@@ -4,7 +4,17 @@
 #include "lwip/tcp.h"
 #include "lwip/priv/tcpip_priv.h"
 
+/// 事件优先级：连接控制事件最先处理，其次为数据事件，轮询事件最后（同一优先级内先进先出）
+enum class AsyncPriority : uint8_t {
+    Control = 0,
+    Data,
+    Poll,
+};
+using AsyncJobFn = void (*)(void* arg);
+
 extern void abort_tcp(tcp_pcb* pcb);
 extern err_t close_tcp(tcp_pcb* pcb);
+extern bool async_schedule(AsyncPriority prio, AsyncJobFn fn, void* arg, AsyncJobFn cleanup = nullptr);
+extern size_t async_pending();
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,271 @@
+#include "AsyncBench.h"
+
+#if CONFIG_ASYNC_TCP_BENCH
+#include "AsyncServer.h"
+#include "bench_peer.h"
+#include "json_writer.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#define TAG "AsyncBench"
+#define BENCH_WAIT_MS       5000    // 等待连接建立、回调执行或服务器关闭的最长时间
+#define BENCH_WARMUP_MS     500     // 背景负载建立后等待数据事件积压的时间
+
+static const ip_addr_t s_loopback = IPADDR4_INIT_BYTES(127, 0, 0, 1);
+
+/// 接入延迟测试状态
+struct latency_state_t {
+    SemaphoreHandle_t   handled;        // 测量连接的接入回调已执行
+    int64_t             handled_us;     // 接入回调执行的时间
+    int                 probe_listener; // 测量连接使用的监听端口编号
+    uint16_t            work_us;
+};
+
+/// @brief 统计延迟样本（样本会被排序）
+bench_latency_t bench_summarize(uint32_t* samples, size_t count, uint32_t failed)
+{
+    bench_latency_t result = {};
+    result.count = count;
+    result.failed = failed;
+    if (count == 0) {
+        return result;
+    }
+    std::sort(samples, samples + count);
+    result.min = samples[0];
+    result.p50 = samples[(count - 1) * 50 / 100];
+    result.p90 = samples[(count - 1) * 90 / 100];
+    result.p99 = samples[(count - 1) * 99 / 100];
+    result.max = samples[count - 1];
+    return result;
+}
+
+void bench_append_latency(json_writer_t& json, const char* name, const bench_latency_t& latency)
+{
+    json.append("\"%s\":{\"count\":%lu,\"failed\":%lu,\"min_us\":%lu,\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu}",
+        name, (unsigned long)latency.count, (unsigned long)latency.failed, (unsigned long)latency.min,
+        (unsigned long)latency.p50, (unsigned long)latency.p90, (unsigned long)latency.p99, (unsigned long)latency.max);
+}
+
+/// @brief 强制断开服务器的所有连接，等待连接全部回收后释放服务器
+/// @return 等待超时（服务器未释放）时返回false
+bool bench_destroy_server(AsyncServer* server)
+{
+    auto done = xSemaphoreCreateBinary();
+    server->end(AsyncShutdownMode::Immediate, 0, [](void* arg) {
+            xSemaphoreGive(reinterpret_cast<SemaphoreHandle_t>(arg));
+        }, done);
+    if (xSemaphoreTake(done, pdMS_TO_TICKS(BENCH_WAIT_MS)) != pdTRUE) {
+        // 仍有连接等待回收，保留服务器以免回收时访问已释放的对象
+        ESP_LOGE(TAG, "服务器关闭超时，%u个连接尚未回收", (unsigned)server->get_live_count());
+        return false;
+    }
+    vSemaphoreDelete(done);
+    delete server;
+    return true;
+}
+
+static void on_bulk_data(void* arg, void* data, size_t len)
+{
+    esp_rom_delay_us(reinterpret_cast<latency_state_t*>(arg)->work_us);
+}
+
+static void on_accepted(void* arg, AsyncClient* c)
+{
+    auto* state = reinterpret_cast<latency_state_t*>(arg);
+    if (c->get_listener_id() == state->probe_listener) {
+        state->handled_us = esp_timer_get_time();
+        xSemaphoreGive(state->handled);
+    }
+}
+
+/// @brief 逐个发起测量连接，记录发起连接至服务器接入回调执行的时间
+static bench_latency_t probe(latency_state_t* state, bench_peer_group_t* group, const AsyncBenchLatencyConfig* config,
+    uint32_t* samples, size_t* max_pending)
+{
+    bench_peer_t peer;
+    peer.group = group;
+    size_t count = 0;
+    uint32_t failed = 0;
+    for (uint16_t i = 0; i < config->probes; i++) {
+        xSemaphoreTake(state->handled, 0);      // 清除上一次超时后迟到的通知
+        if (!bench_peer_connect(&peer)) {
+            failed++;
+            continue;
+        }
+        if (xSemaphoreTake(state->handled, pdMS_TO_TICKS(BENCH_WAIT_MS)) == pdTRUE) {
+            samples[count++] = state->handled_us - peer.start_us;
+        } else {
+            failed++;
+        }
+        auto pending = async_pending();
+        if (pending > *max_pending) {
+            *max_pending = pending;
+        }
+        bench_peer_close(&peer, false);
+        vTaskDelay(pdMS_TO_TICKS(config->interval_ms));
+    }
+    return bench_summarize(samples, count, failed);
+}
+
+size_t async_bench_connect_latency(const AsyncBenchLatencyConfig* config, char* json, size_t len)
+{
+    AsyncBenchLatencyConfig defaults;
+    if (config == nullptr) {
+        config = &defaults;
+    }
+    json_writer_t out(json, len);
+    latency_state_t state = {};
+    state.handled = xSemaphoreCreateBinary();
+    state.work_us = config->work_us;
+    auto* samples = new (std::nothrow) uint32_t[config->probes ? config->probes : 1];
+    auto* chunk = new (std::nothrow) uint8_t[config->bulk_chunk ? config->bulk_chunk : 1]();
+    auto* bulk = new (std::nothrow) bench_peer_t[config->bulk_clients ? config->bulk_clients : 1];
+    auto* server = new (std::nothrow) AsyncServer(s_loopback, config->port);
+    if (state.handled == nullptr || samples == nullptr || chunk == nullptr || bulk == nullptr || server == nullptr) {
+        out.append("{\"bench\":\"connect_latency\",\"error\":\"no memory\"}");
+        delete server;
+        delete[] bulk;
+        delete[] chunk;
+        delete[] samples;
+        if (state.handled) {
+            vSemaphoreDelete(state.handled);
+        }
+        return out.finish();
+    }
+
+    // 背景连接的数据经数据事件交给模拟处理，测量连接经独立的监听端口接入
+    AsyncClientProfile profile;
+    profile.on_data_received_handler = on_bulk_data;
+    profile.on_data_received_arg = &state;
+    server->set_client_profile(&profile);
+    server->set_connected_handler(on_accepted, &state);
+    state.probe_listener = server->add_listener(s_loopback, config->port + 1);
+    server->begin();
+
+    bench_peer_group_t probes;
+    probes.addr = s_loopback;
+    probes.port = config->port + 1;
+    bench_peer_group_t load;
+    load.addr = s_loopback;
+    load.port = config->port;
+    load.chunk = chunk;
+    load.chunk_len = config->bulk_chunk;
+
+    size_t idle_pending = 0;
+    auto idle = probe(&state, &probes, config, samples, &idle_pending);
+
+    for (uint8_t i = 0; i < config->bulk_clients; i++) {
+        bulk[i].group = &load;
+        bench_peer_connect(&bulk[i]);
+    }
+    auto wait_start = esp_timer_get_time();
+    while (bench_peer_stats(&load).connected < config->bulk_clients
+        && esp_timer_get_time() - wait_start < BENCH_WAIT_MS * 1000LL) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    vTaskDelay(pdMS_TO_TICKS(BENCH_WARMUP_MS));
+
+    size_t loaded_pending = 0;
+    auto before = bench_peer_stats(&load);
+    auto start = esp_timer_get_time();
+    auto loaded = probe(&state, &probes, config, samples, &loaded_pending);
+    auto after = bench_peer_stats(&load);
+    auto elapsed = esp_timer_get_time() - start;
+
+    for (uint8_t i = 0; i < config->bulk_clients; i++) {
+        bench_peer_close(&bulk[i], true);
+    }
+    bench_destroy_server(server);
+
+    out.append("{\"bench\":\"connect_latency\",\"bulk_clients\":%u,\"bulk_connected\":%lu,\"bulk_chunk\":%u,\"work_us\":%u,",
+        config->bulk_clients, (unsigned long)after.connected, config->bulk_chunk, config->work_us);
+    bench_append_latency(out, "idle", idle);
+    out.append(",");
+    bench_append_latency(out, "loaded", loaded);
+    out.append(",\"idle_max_pending_events\":%u,\"loaded_max_pending_events\":%u,\"bulk_bytes_per_sec\":%llu}",
+        (unsigned)idle_pending, (unsigned)loaded_pending,
+        elapsed > 0 ? (unsigned long long)((after.tx_bytes - before.tx_bytes) * 1000000 / elapsed) : 0ULL);
+
+    delete[] bulk;
+    delete[] chunk;
+    delete[] samples;
+    vSemaphoreDelete(state.handled);
+    return out.finish();
+}
+
+static void on_accept_counted(void* arg, AsyncClient* c)
+{
+    (*reinterpret_cast<std::atomic<uint32_t>*>(arg))++;
+}
+
+size_t async_bench_accept_rate(const AsyncBenchAcceptConfig* config, char* json, size_t len)
+{
+    AsyncBenchAcceptConfig defaults;
+    if (config == nullptr) {
+        config = &defaults;
+    }
+    json_writer_t out(json, len);
+    auto* peers = new (std::nothrow) bench_peer_t[config->clients ? config->clients : 1];
+    auto* server = new (std::nothrow) AsyncServer(s_loopback, config->port);
+    if (peers == nullptr || server == nullptr) {
+        out.append("{\"bench\":\"accept_rate\",\"error\":\"no memory\"}");
+        delete server;
+        delete[] peers;
+        return out.finish();
+    }
+    std::atomic<uint32_t> handled{0};
+    server->set_connected_handler(on_accept_counted, &handled);
+    server->begin();
+
+    // 对端建立连接后立即关闭（FIN），空闲后由本任务重新发起连接
+    bench_peer_group_t group;
+    group.addr = s_loopback;
+    group.port = config->port;
+    group.on_connected = [](bench_peer_t* peer, void* arg) {
+        return false;
+    };
+    for (uint8_t i = 0; i < config->clients; i++) {
+        peers[i].group = &group;
+    }
+
+    auto before = server->get_stats();
+    auto start = esp_timer_get_time();
+    int64_t elapsed = 0;
+    while ((elapsed = esp_timer_get_time() - start) < config->duration_ms * 1000LL) {
+        bool issued = false;
+        for (uint8_t i = 0; i < config->clients; i++) {
+            issued |= bench_peer_connect(&peers[i]);
+        }
+        if (!issued) {
+            vTaskDelay(1);
+        }
+    }
+    auto after = server->get_stats();
+    auto peer_stats = bench_peer_stats(&group);
+
+    for (uint8_t i = 0; i < config->clients; i++) {
+        bench_peer_close(&peers[i], true);
+    }
+    bench_destroy_server(server);
+
+    uint32_t accepted = after.accepted - before.accepted;
+    out.append("{\"bench\":\"accept_rate\",\"clients\":%u,\"duration_ms\":%lu,\"accepted\":%lu,\"accepts_per_sec\":%lu,"
+        "\"handled\":%lu,\"recycled\":%lu,\"rejected\":%lu,\"connect_failed\":%lu,\"allocated\":%u,\"pooled\":%u}",
+        config->clients, (unsigned long)(elapsed / 1000), (unsigned long)accepted,
+        (unsigned long)(elapsed > 0 ? (uint64_t)accepted * 1000000 / elapsed : 0),
+        (unsigned long)handled.load(), (unsigned long)(after.recycled - before.recycled),
+        (unsigned long)(after.rejected - before.rejected), (unsigned long)peer_stats.failed,
+        (unsigned)after.allocated, (unsigned)after.pooled);
+
+    delete[] peers;
+    return out.finish();
+}
+
+#endif
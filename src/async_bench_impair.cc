@@ -0,0 +1,245 @@
+#include "AsyncBench.h"
+
+#if CONFIG_ASYNC_TCP_BENCH && CONFIG_ASYNC_TCP_IMPAIRMENT
+#include "bench_peer.h"
+#include "json_writer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/ip4.h"
+#include "lwip/netif.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#define TAG "AsyncImpairBench"
+#define IMPAIR_CONNECT_MS   5000    // 等待连接建立的最长时间
+#define IMPAIR_DRAIN_MS     10000   // 发送完最后一条消息后等待回显的最长时间
+#define IMPAIR_SETTLE_MS    500     // 用例之间等待延迟报文发出、连接释放的时间
+
+static const AsyncBenchImpairCase s_default_cases[] = {
+    { "clean", {} },
+    { "delay_50ms", { 50 } },
+    { "jitter_20_40ms", { 20, 40 } },
+    { "loss_2pct", { 0, 0, 20 } },
+    { "reorder_5pct_30ms", { 0, 0, 0, 50, 30 } },
+    { "rate_128KBps", { 0, 0, 0, 0, 0, 128 * 1024, 500 } },
+};
+
+/// 往返延迟测量状态（samples与received仅在tcpip线程中写入）
+struct impair_latency_t {
+    int64_t*                sent_us;    // 各消息的发送时间（在提交发送前写入）
+    uint32_t*               samples;
+    uint16_t                capacity;   // 样本数组的长度
+    uint16_t                msg_len;
+    uint32_t                pending;    // 已收到但未凑满一条消息的字节数
+    std::atomic<uint16_t>   received;   // 已收到完整回显的消息数
+};
+
+struct impair_route_data_t {
+    tcpip_api_call_data*    data;
+    const ip_addr_t*        addr;
+    struct netif*           netif;
+};
+
+/// @brief 收到回显数据（tcpip线程）：回显按发送顺序到达，每凑满一条消息记录一次往返延迟
+static void on_echo(bench_peer_t* peer, size_t len, void* arg)
+{
+    auto* state = reinterpret_cast<impair_latency_t*>(arg);
+    auto now = esp_timer_get_time();
+    auto received = state->received.load();
+    state->pending += len;
+    while (state->pending >= state->msg_len && received < state->capacity) {
+        state->pending -= state->msg_len;
+        state->samples[received] = now - state->sent_us[received];
+        received++;
+    }
+    state->received = received;
+}
+
+/// @brief 查找通往地址的网卡（回环地址与本机地址除外）
+static struct netif* route(const ip_addr_t* addr)
+{
+    impair_route_data_t msg = {
+        .data = nullptr,
+        .addr = addr,
+        .netif = nullptr
+    };
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<impair_route_data_t*>(data);
+            msg->netif = ip4_route(ip_2_ip4(msg->addr));
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    return msg.netif;
+}
+
+/// @brief 等待对端组在connected的基础上新建立count个连接
+/// @return 超时或连接均已失败时返回false
+static bool wait_connected(bench_peer_group_t* group, uint32_t connected, uint32_t count)
+{
+    auto start = esp_timer_get_time();
+    while (esp_timer_get_time() - start < IMPAIR_CONNECT_MS * 1000LL) {
+        auto stats = bench_peer_stats(group);
+        if (stats.connected - connected >= count) {
+            return true;
+        }
+        if (stats.open == 0) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return false;
+}
+
+/// @brief 多个连接持续发送，测量写入与回显的字节速率
+static void measure_throughput(bench_peer_group_t* group, bench_peer_t* peers, const AsyncBenchImpairConfig* config,
+    json_writer_t& out)
+{
+    auto initial = bench_peer_stats(group);
+    for (uint8_t i = 0; i < config->flows; i++) {
+        peers[i].group = group;
+        bench_peer_connect(&peers[i]);
+    }
+    wait_connected(group, initial.connected, config->flows);
+
+    auto before = bench_peer_stats(group);
+    auto start = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(config->duration_ms));
+    auto after = bench_peer_stats(group);
+    auto elapsed = esp_timer_get_time() - start;
+    for (uint8_t i = 0; i < config->flows; i++) {
+        bench_peer_close(&peers[i], true);
+    }
+
+    out.append("\"flows_connected\":%lu,\"tx_bytes_per_sec\":%llu,\"echo_bytes_per_sec\":%llu,\"resets\":%lu,",
+        (unsigned long)(after.connected - initial.connected),
+        elapsed > 0 ? (unsigned long long)((after.tx_bytes - before.tx_bytes) * 1000000 / elapsed) : 0ULL,
+        elapsed > 0 ? (unsigned long long)((after.rx_bytes - before.rx_bytes) * 1000000 / elapsed) : 0ULL,
+        (unsigned long)(after.reset - before.reset));
+}
+
+/// @brief 逐条发送消息，测量从提交发送到收到完整回显的往返延迟
+static void measure_latency(bench_peer_group_t* group, impair_latency_t* state, const AsyncBenchImpairConfig* config,
+    json_writer_t& out)
+{
+    state->pending = 0;
+    state->received = 0;
+    bench_peer_t peer;
+    peer.group = group;
+    auto initial = bench_peer_stats(group);
+    bool connected = bench_peer_connect(&peer) && wait_connected(group, initial.connected, 1);
+
+    // 发送缓冲区不足时稍后重试（延迟中包含等待的时间），连接中断时停止
+    uint16_t sent = 0;
+    while (connected && sent < state->capacity) {
+        state->sent_us[sent] = esp_timer_get_time();
+        while (!bench_peer_send(&peer, state->msg_len)) {
+            if (bench_peer_stats(group).open == 0) {
+                connected = false;
+                break;
+            }
+            vTaskDelay(1);
+        }
+        if (connected) {
+            sent++;
+            vTaskDelay(pdMS_TO_TICKS(config->interval_ms));
+        }
+    }
+    auto drain_start = esp_timer_get_time();
+    while (state->received.load() < sent && esp_timer_get_time() - drain_start < IMPAIR_DRAIN_MS * 1000LL) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    bench_peer_close(&peer, true);
+    // 关闭后tcpip线程不再写入样本
+    auto received = state->received.load();
+    auto latency = bench_summarize(state->samples, received, state->capacity - received);
+    bench_append_latency(out, "rtt", latency);
+}
+
+size_t async_bench_impairment(const AsyncBenchImpairConfig* config, char* json, size_t len)
+{
+    AsyncBenchImpairConfig defaults;
+    if (config == nullptr) {
+        config = &defaults;
+    }
+    json_writer_t out(json, len);
+    auto* cases = config->cases;
+    uint8_t case_count = config->case_count;
+    if (cases == nullptr) {
+        cases = s_default_cases;
+        case_count = sizeof(s_default_cases) / sizeof(s_default_cases[0]);
+    }
+    uint16_t chunk_len = config->chunk ? config->chunk : 1;
+    uint16_t messages = config->messages ? config->messages : 1;
+
+    auto* netif = ip_addr_isany(&config->echo_addr) ? nullptr : route(&config->echo_addr);
+    if (netif == nullptr) {
+        out.append("{\"bench\":\"impairment\",\"error\":\"no route to echo server\"}");
+        return out.finish();
+    }
+    auto* chunk = new (std::nothrow) uint8_t[chunk_len]();
+    auto* peers = new (std::nothrow) bench_peer_t[config->flows ? config->flows : 1];
+    auto* sent_us = new (std::nothrow) int64_t[messages];
+    auto* samples = new (std::nothrow) uint32_t[messages];
+    if (chunk == nullptr || peers == nullptr || sent_us == nullptr || samples == nullptr) {
+        out.append("{\"bench\":\"impairment\",\"error\":\"no memory\"}");
+        delete[] samples;
+        delete[] sent_us;
+        delete[] peers;
+        delete[] chunk;
+        return out.finish();
+    }
+
+    impair_latency_t state;
+    state.sent_us = sent_us;
+    state.samples = samples;
+    state.capacity = messages;
+    state.msg_len = std::max<uint16_t>(std::min(config->msg_len, chunk_len), 1);
+
+    bench_peer_group_t bulk;
+    bulk.addr = config->echo_addr;
+    bulk.port = config->echo_port;
+    bulk.chunk = chunk;
+    bulk.chunk_len = chunk_len;
+    bench_peer_group_t probe;
+    probe.addr = config->echo_addr;
+    probe.port = config->echo_port;
+    probe.chunk = chunk;
+    probe.chunk_len = chunk_len;
+    probe.flood = false;
+    probe.on_received = on_echo;
+    probe.on_received_arg = &state;
+
+    out.append("{\"bench\":\"impairment\",\"flows\":%u,\"chunk\":%u,\"duration_ms\":%lu,\"messages\":%u,\"msg_len\":%u,\"cases\":[",
+        config->flows, chunk_len, (unsigned long)config->duration_ms, messages, state.msg_len);
+    for (uint8_t i = 0; i < case_count; i++) {
+        auto& c = cases[i];
+        ESP_LOGI(TAG, "用例 %s", c.name);
+        async_impair_attach(netif, &c.link);
+        out.append("%s{\"name\":\"%s\",\"delay_ms\":%lu,\"jitter_ms\":%lu,\"loss_permille\":%u,\"reorder_permille\":%u,"
+            "\"reorder_ms\":%lu,\"rate_bytes_per_sec\":%lu,",
+            i ? "," : "", c.name, (unsigned long)c.link.delay_ms, (unsigned long)c.link.jitter_ms, c.link.loss_permille,
+            c.link.reorder_permille, (unsigned long)c.link.reorder_ms, (unsigned long)c.link.rate_bytes_per_sec);
+        measure_throughput(&bulk, peers, config, out);
+        measure_latency(&probe, &state, config, out);
+        auto impair = async_impair_stats();
+        async_impair_detach();
+        out.append(",\"impair\":{\"passed\":%lu,\"delayed\":%lu,\"reordered\":%lu,\"dropped\":%lu,\"overflow\":%lu}}",
+            (unsigned long)impair.passed, (unsigned long)impair.delayed, (unsigned long)impair.reordered,
+            (unsigned long)impair.dropped, (unsigned long)impair.overflow);
+        vTaskDelay(pdMS_TO_TICKS(IMPAIR_SETTLE_MS));
+    }
+    out.append("]}");
+
+    delete[] samples;
+    delete[] sent_us;
+    delete[] peers;
+    delete[] chunk;
+    return out.finish();
+}
+
+#endif
@@ -0,0 +1,348 @@
+#include "AsyncBench.h"
+
+#if CONFIG_ASYNC_TCP_BENCH
+#include "AsyncServer.h"
+#include "AsyncProfile.h"
+#include "bench_peer.h"
+#include "client_events.h"
+#include "json_writer.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+#include <atomic>
+#include <new>
+#include <string.h>
+
+#define MICRO_WAIT_MS       5000    // 等待连接建立或事件处理完成的最长时间
+#define MICRO_SEGMENT_LEN   64      // 接收分发测量中每段pbuf的长度
+#define MICRO_JSON_LEN      2048    // 统计输出测量使用的缓冲区长度
+#define MICRO_MAX_BATCH     16      // 分配测量每批连接数的上限（pcb数组位于tcpip线程栈上）
+
+static const ip_addr_t s_loopback = IPADDR4_INIT_BYTES(127, 0, 0, 1);
+
+/// 微基准测试对内部路径的访问入口
+struct AsyncBenchAccess {
+    using event_t = AsyncClient::async_event_t;
+
+    static void release(AsyncClient* c) {
+        c->Release();
+    }
+    static void dispatch(AsyncClient* c, pbuf* pb) {
+        AsyncClient::ProfilePolicy::on_data(c, pb);
+    }
+    static bool is_active(AsyncClient* c) {
+        return c->IsActive();
+    }
+};
+
+struct micro_alloc_data_t {
+    tcpip_api_call_data*    data;
+    AsyncServer*            server;
+    AsyncClient**           clients;
+    uint8_t                 count;
+    int64_t                 elapsed_us;     // 分配耗时（不含创建pcb）
+};
+
+/// 发送测量使用的连接
+struct micro_conn_t {
+    SemaphoreHandle_t       ready;
+    AsyncClient*            client;
+};
+
+/// @brief 每次操作的平均耗时（纳秒）
+static unsigned long per_op_ns(int64_t elapsed_us, uint32_t count)
+{
+    return count ? (unsigned long)(elapsed_us * 1000 / count) : 0;
+}
+
+/// @brief 在tcpip线程中创建pcb并分配一批连接，返回分配的连接数
+static uint8_t allocate_batch(AsyncServer* server, AsyncClient** clients, uint8_t count, int64_t* elapsed_us)
+{
+    micro_alloc_data_t msg = {
+        .data = nullptr,
+        .server = server,
+        .clients = clients,
+        .count = count,
+        .elapsed_us = 0
+    };
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<micro_alloc_data_t*>(data);
+            tcp_pcb* pcbs[MICRO_MAX_BATCH];
+            uint8_t n = 0;
+            while (n < msg->count && (pcbs[n] = tcp_new_ip_type(IPADDR_TYPE_V4)) != nullptr) {
+                n++;
+            }
+            auto start = esp_timer_get_time();
+            for (uint8_t i = 0; i < n; i++) {
+                msg->clients[i] = msg->server->allocateClient(pcbs[i]);
+            }
+            msg->elapsed_us = esp_timer_get_time() - start;
+            msg->count = n;
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    *elapsed_us += msg.elapsed_us;
+    return msg.count;
+}
+
+/// @brief 测量连接分配与回收：首轮连接池为空，分配即新建；此后连接均取自连接池
+static void bench_allocate(json_writer_t& out, const AsyncBenchMicroConfig* config)
+{
+    uint8_t batch = config->batch ? (config->batch < MICRO_MAX_BATCH ? config->batch : MICRO_MAX_BATCH) : 1;
+    auto* clients = new (std::nothrow) AsyncClient*[batch];
+    auto* server = new (std::nothrow) AsyncServer(s_loopback, config->port);
+    if (clients == nullptr || server == nullptr) {
+        out.append("\"allocate\":null");
+        delete server;
+        delete[] clients;
+        return;
+    }
+    int64_t new_us = 0, pooled_us = 0, recycle_us = 0;
+    uint32_t created = 0, pooled = 0, recycled = 0;
+    for (uint32_t done = 0; done < config->iterations; ) {
+        bool first = created == 0;
+        auto n = allocate_batch(server, clients, batch, first ? &new_us : &pooled_us);
+        if (n == 0) {
+            break;
+        }
+        if (first) {
+            created = n;
+        } else {
+            pooled += n;
+        }
+        // 回收包含调用方等待tcpip线程释放pcb的时间
+        auto start = esp_timer_get_time();
+        for (uint8_t i = 0; i < n; i++) {
+            AsyncBenchAccess::release(clients[i]);
+        }
+        recycle_us += esp_timer_get_time() - start;
+        recycled += n;
+        done += n;
+    }
+    out.append("\"allocate\":{\"new_ns\":%lu,\"pooled_ns\":%lu,\"recycle_ns\":%lu,\"count\":%lu}",
+        per_op_ns(new_us, created), per_op_ns(pooled_us, pooled), per_op_ns(recycle_us, recycled),
+        (unsigned long)recycled);
+    delete server;
+    delete[] clients;
+}
+
+/// @brief 测量事件对象的生命周期：创建、提交、执行空处理函数、清理并释放
+static void bench_events(json_writer_t& out, const AsyncBenchMicroConfig* config)
+{
+    std::atomic<uint32_t> cleaned{0};
+    int64_t schedule_us = 0;
+    uint32_t scheduled = 0;
+    auto start = esp_timer_get_time();
+    for (uint32_t i = 0; i < config->iterations; i++) {
+        auto* event = new AsyncBenchAccess::event_t;
+        event->arg = &cleaned;
+        auto t = esp_timer_get_time();
+        auto ok = async_schedule(AsyncPriority::Data, [](void* arg) {}, event, [](void* arg) {
+                auto* event = reinterpret_cast<AsyncBenchAccess::event_t*>(arg);
+                (*reinterpret_cast<std::atomic<uint32_t>*>(event->arg))++;
+                delete event;
+            });
+        schedule_us += esp_timer_get_time() - t;
+        if (!ok) {
+            delete event;
+            continue;
+        }
+        scheduled++;
+    }
+    while (cleaned.load() < scheduled && esp_timer_get_time() - start < MICRO_WAIT_MS * 1000LL) {
+        vTaskDelay(1);
+    }
+    auto elapsed = esp_timer_get_time() - start;
+    out.append("\"event\":{\"schedule_ns\":%lu,\"lifecycle_ns\":%lu,\"count\":%lu,\"lost\":%lu}",
+        per_op_ns(schedule_us, scheduled), per_op_ns(elapsed, scheduled), (unsigned long)scheduled,
+        (unsigned long)(scheduled - cleaned.load()));
+}
+
+/// @brief 测量一种发送方式，等待发送缓冲区的时间不计入
+template <class F>
+static void bench_send_mode(json_writer_t& out, const char* name, AsyncClient* c, const AsyncBenchMicroConfig* config, F send)
+{
+    int64_t elapsed = 0;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < config->iterations; i++) {
+        auto wait_start = esp_timer_get_time();
+        while (c->get_send_buffer_size() < config->write_len && esp_timer_get_time() - wait_start < MICRO_WAIT_MS * 1000LL) {
+            vTaskDelay(1);
+        }
+        auto start = esp_timer_get_time();
+        auto ok = send();
+        elapsed += esp_timer_get_time() - start;
+        if (!ok) {
+            break;
+        }
+        count++;
+    }
+    out.append("\"%s\":{\"ns\":%lu,\"count\":%lu}", name, per_op_ns(elapsed, count), (unsigned long)count);
+}
+
+/// @brief 测量IsActive()在已建立的连接与未关联pcb的连接上的耗时
+static void bench_is_active(json_writer_t& out, AsyncClient* live, const AsyncBenchMicroConfig* config)
+{
+    AsyncClient idle;
+    uint32_t active = 0;
+    auto start = esp_timer_get_time();
+    for (uint32_t i = 0; i < config->iterations; i++) {
+        active += AsyncBenchAccess::is_active(live);
+    }
+    auto live_us = esp_timer_get_time() - start;
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < config->iterations; i++) {
+        active += AsyncBenchAccess::is_active(&idle);
+    }
+    auto idle_us = esp_timer_get_time() - start;
+    // active应等于iterations（仅已建立的连接返回true），同时避免调用被优化掉
+    out.append("\"is_active\":{\"active_ns\":%lu,\"idle_ns\":%lu,\"count\":%lu,\"ok\":%s}",
+        per_op_ns(live_us, config->iterations), per_op_ns(idle_us, config->iterations),
+        (unsigned long)config->iterations, active == config->iterations ? "true" : "false");
+}
+
+/// @brief 测量add()+send()、write()与自动合包下write()的耗时（对端只接收不发送），以及IsActive()的耗时
+static void bench_send(json_writer_t& out, const AsyncBenchMicroConfig* config)
+{
+    uint16_t write_len = config->write_len ? config->write_len : 1;
+    auto* chunk = new (std::nothrow) uint8_t[write_len]();
+    auto* server = new (std::nothrow) AsyncServer(s_loopback, config->port);
+    micro_conn_t conn = { xSemaphoreCreateBinary(), nullptr };
+    if (chunk == nullptr || server == nullptr || conn.ready == nullptr) {
+        out.append("\"send\":null,\"is_active\":null");
+        delete server;
+        delete[] chunk;
+        if (conn.ready) {
+            vSemaphoreDelete(conn.ready);
+        }
+        return;
+    }
+    server->set_connected_handler([](void* arg, AsyncClient* c) {
+            auto* conn = reinterpret_cast<micro_conn_t*>(arg);
+            conn->client = c;
+            xSemaphoreGive(conn->ready);
+        }, &conn);
+    server->begin();
+
+    bench_peer_group_t group;
+    group.addr = s_loopback;
+    group.port = config->port;
+    bench_peer_t peer;
+    peer.group = &group;
+    if (!bench_peer_connect(&peer) || xSemaphoreTake(conn.ready, pdMS_TO_TICKS(MICRO_WAIT_MS)) != pdTRUE) {
+        out.append("\"send\":null,\"is_active\":null");
+    } else {
+        auto* c = conn.client;
+        bench_is_active(out, c, config);
+        out.append(",");
+        out.append("\"send\":{");
+        bench_send_mode(out, "add_send", c, config, [&]() {
+                return c->add(chunk, write_len, TCP_WRITE_FLAG_COPY) == write_len && c->send();
+            });
+        out.append(",");
+        bench_send_mode(out, "write", c, config, [&]() {
+                return c->write(chunk, write_len) == write_len;
+            });
+        out.append(",");
+        c->set_auto_cork(true);
+        bench_send_mode(out, "write_corked", c, config, [&]() {
+                return c->write(chunk, write_len) == write_len;
+            });
+        out.append("}");
+    }
+    bench_peer_close(&peer, true);
+    bench_destroy_server(server);
+    vSemaphoreDelete(conn.ready);
+    delete[] chunk;
+}
+
+static void count_data(void* arg, void* data, size_t len)
+{
+    *reinterpret_cast<size_t*>(arg) += len;
+}
+
+/// @brief 测量1~ASYNC_PROF_MAX_CHAIN段pbuf链逐段交给数据回调的耗时
+static void bench_recv_chain(json_writer_t& out, const AsyncBenchMicroConfig* config)
+{
+    AsyncClient client;
+    size_t received = 0;
+    client.set_data_received_handler(count_data, &received);
+    out.append("\"recv_chain_ns\":[");
+    for (int segments = 1; segments <= ASYNC_PROF_MAX_CHAIN; segments++) {
+        pbuf* chain = nullptr;
+        for (int i = 0; i < segments; i++) {
+            auto* pb = pbuf_alloc(PBUF_RAW, MICRO_SEGMENT_LEN, PBUF_RAM);
+            if (pb == nullptr) {
+                break;
+            }
+            if (chain) {
+                pbuf_cat(chain, pb);
+            } else {
+                chain = pb;
+            }
+        }
+        unsigned long ns = 0;
+        if (chain) {
+            auto start = esp_timer_get_time();
+            for (uint32_t i = 0; i < config->iterations; i++) {
+                AsyncBenchAccess::dispatch(&client, chain);
+            }
+            ns = per_op_ns(esp_timer_get_time() - start, config->iterations);
+            pbuf_free(chain);
+        }
+        out.append("%s%lu", segments > 1 ? "," : "", ns);
+    }
+    out.append("]");
+}
+
+/// @brief 测量统计输出的耗时，并检查缓冲区不足时的长度约定（返回所需长度、不输出不完整的JSON）
+static void bench_prof_json(json_writer_t& out, const AsyncBenchMicroConfig* config)
+{
+    auto* buf = new (std::nothrow) char[MICRO_JSON_LEN];
+    if (buf == nullptr) {
+        out.append("\"prof_json\":null");
+        return;
+    }
+    auto need = async_prof_dump_json(nullptr, 0);
+    bool ok = need > 0 && need < MICRO_JSON_LEN;
+    if (ok) {
+        memset(buf, 'x', MICRO_JSON_LEN);
+        ok = async_prof_dump_json(buf, need) == need && buf[0] == '\0';
+    }
+    if (ok) {
+        ok = async_prof_dump_json(buf, need + 1) == need && strlen(buf) == need && buf[need - 1] == '}';
+    }
+    auto start = esp_timer_get_time();
+    for (uint32_t i = 0; i < config->iterations; i++) {
+        async_prof_dump_json(buf, MICRO_JSON_LEN);
+    }
+    out.append("\"prof_json\":{\"ns\":%lu,\"len\":%u,\"ok\":%s}",
+        per_op_ns(esp_timer_get_time() - start, config->iterations), (unsigned)need, ok ? "true" : "false");
+    delete[] buf;
+}
+
+size_t async_bench_micro(const AsyncBenchMicroConfig* config, char* json, size_t len)
+{
+    AsyncBenchMicroConfig defaults;
+    if (config == nullptr) {
+        config = &defaults;
+    }
+    json_writer_t out(json, len);
+    out.append("{\"bench\":\"micro\",\"iterations\":%lu,", (unsigned long)config->iterations);
+    bench_allocate(out, config);
+    out.append(",");
+    bench_events(out, config);
+    out.append(",");
+    bench_send(out, config);
+    out.append(",");
+    bench_recv_chain(out, config);
+    out.append(",");
+    bench_prof_json(out, config);
+    out.append("}");
+    return out.finish();
+}
+
+#endif
@@ -0,0 +1,222 @@
+#include "AsyncBench.h"
+
+#if CONFIG_ASYNC_TCP_BENCH
+#include "AsyncClient.h"
+#include "client_pool.h"
+#include "json_writer.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#define POOL_BENCH_BATCH        8       // 每次tcpip调用取出的连接数
+#define POOL_BENCH_ROUNDS       10000   // 单线程往返测试的次数
+#define POOL_BENCH_STACK        3072    // 归还任务的栈大小
+#define POOL_BENCH_PRIORITY     5       // 归还任务的优先级
+
+/// 连接池压力测试状态
+struct pool_bench_t {
+    AsyncClientPool         pool;
+    AsyncClient**           clients{nullptr};   // 按地址排序，用于查找连接编号
+    std::atomic<bool>*      taken{nullptr};     // 连接是否已被取出
+    uint16_t                count{0};
+    QueueHandle_t           returns{nullptr};   // 已取出、等待归还的连接
+    std::atomic<bool>       stop{false};
+    std::atomic<uint8_t>    running{0};         // 仍在运行的归还任务数
+    std::atomic<uint32_t>   errors{0};          // 取出不属于测试的连接、重复取出或重复归还的次数
+    std::atomic<uint32_t>   returned{0};        // 累计归还次数
+};
+
+struct pool_call_data_t {
+    tcpip_api_call_data*    data;
+    pool_bench_t*           bench;
+    uint32_t                count;      // 单线程往返次数 / 本次取出的连接数
+    int64_t                 elapsed_us;
+    AsyncClient*            list;
+};
+
+/// @brief 标记连接的取出状态，状态不符时记录错误
+static void mark(pool_bench_t* bench, AsyncClient* c, bool taken)
+{
+    auto* it = std::lower_bound(bench->clients, bench->clients + bench->count, c);
+    if (it == bench->clients + bench->count || *it != c || bench->taken[it - bench->clients].exchange(taken) == taken) {
+        bench->errors++;
+    }
+}
+
+/// @brief 归还任务：将取出的连接放回连接池（模拟各核心上后台任务回收连接）
+static void returner(void* arg)
+{
+    auto* bench = reinterpret_cast<pool_bench_t*>(arg);
+    AsyncClient* c;
+    while (!bench->stop.load()) {
+        if (xQueueReceive(bench->returns, &c, pdMS_TO_TICKS(10)) == pdTRUE) {
+            mark(bench, c, false);
+            bench->pool.push(c);
+            bench->returned++;
+        }
+    }
+    bench->running--;
+    vTaskDelete(nullptr);
+}
+
+/// @brief 在tcpip线程中取出一批连接交给归还任务（与接入时的取出方式相同）
+static uint32_t take_batch(pool_bench_t* bench)
+{
+    pool_call_data_t msg = {};
+    msg.bench = bench;
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<pool_call_data_t*>(data);
+            auto* bench = msg->bench;
+            for (int i = 0; i < POOL_BENCH_BATCH; i++) {
+                auto* c = bench->pool.pop();
+                if (c == nullptr) {
+                    break;
+                }
+                mark(bench, c, true);
+                msg->count++;
+                if (xQueueSend(bench->returns, &c, 0) != pdTRUE) {
+                    mark(bench, c, false);
+                    bench->pool.push(c);
+                }
+            }
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    return msg.count;
+}
+
+/// @brief 在tcpip线程中连续取出并放回同一连接，测量无竞争时的往返耗时
+static int64_t measure_roundtrip(pool_bench_t* bench)
+{
+    pool_call_data_t msg = {};
+    msg.bench = bench;
+    msg.count = POOL_BENCH_ROUNDS;
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<pool_call_data_t*>(data);
+            auto start = esp_timer_get_time();
+            for (uint32_t i = 0; i < msg->count; i++) {
+                auto* c = msg->bench->pool.pop();
+                if (c) {
+                    msg->bench->pool.push(c);
+                }
+            }
+            msg->elapsed_us = esp_timer_get_time() - start;
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    return msg.elapsed_us;
+}
+
+/// @brief 在tcpip线程中取出池中所有连接
+static AsyncClient* take_all(pool_bench_t* bench)
+{
+    pool_call_data_t msg = {};
+    msg.bench = bench;
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<pool_call_data_t*>(data);
+            msg->list = msg->bench->pool.take_all();
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    return msg.list;
+}
+
+size_t async_bench_client_pool(const AsyncBenchPoolConfig* config, char* json, size_t len)
+{
+    AsyncBenchPoolConfig defaults;
+    if (config == nullptr) {
+        config = &defaults;
+    }
+    json_writer_t out(json, len);
+    auto* bench = new (std::nothrow) pool_bench_t;
+    uint16_t count = config->clients ? config->clients : 1;
+    if (bench) {
+        bench->clients = new (std::nothrow) AsyncClient*[count]();
+        bench->taken = new (std::nothrow) std::atomic<bool>[count];
+        bench->returns = xQueueCreate(count, sizeof(AsyncClient*));
+    }
+    if (bench == nullptr || bench->clients == nullptr || bench->taken == nullptr || bench->returns == nullptr) {
+        out.append("{\"bench\":\"client_pool\",\"error\":\"no memory\"}");
+        if (bench) {
+            if (bench->returns) {
+                vQueueDelete(bench->returns);
+            }
+            delete[] bench->taken;
+            delete[] bench->clients;
+            delete bench;
+        }
+        return out.finish();
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        bench->clients[i] = new AsyncClient();
+        bench->taken[i] = false;
+    }
+    std::sort(bench->clients, bench->clients + count);
+    bench->count = count;
+    for (uint16_t i = 0; i < count; i++) {
+        bench->pool.push(bench->clients[i]);
+    }
+
+    auto roundtrip_us = measure_roundtrip(bench);
+
+    // 压力测试：tcpip线程取出，归还任务分布在各核心上并发放回
+    for (uint8_t i = 0; i < config->producers; i++) {
+        bench->running++;
+        if (xTaskCreatePinnedToCore(returner, "Pool Bench", POOL_BENCH_STACK, bench, POOL_BENCH_PRIORITY,
+                nullptr, i % portNUM_PROCESSORS) != pdPASS) {
+            bench->running--;
+        }
+    }
+    uint32_t taken = 0;
+    auto start = esp_timer_get_time();
+    int64_t elapsed = 0;
+    while ((elapsed = esp_timer_get_time() - start) < config->duration_ms * 1000LL) {
+        auto n = take_batch(bench);
+        taken += n;
+        if (n == 0) {
+            vTaskDelay(1);
+        }
+    }
+    bench->stop = true;
+    while (bench->running.load()) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    AsyncClient* c;
+    while (xQueueReceive(bench->returns, &c, 0) == pdTRUE) {
+        mark(bench, c, false);
+        bench->pool.push(c);
+    }
+
+    // 所有连接都应回到池中，且每个连接只出现一次
+    uint32_t recovered = 0;
+    for (auto* list = take_all(bench); list && recovered <= count; list = AsyncClientPool::next(list)) {
+        mark(bench, list, true);
+        recovered++;
+    }
+    bool ok = bench->errors.load() == 0 && recovered == count && bench->pool.size() == 0;
+
+    out.append("{\"bench\":\"client_pool\",\"ok\":%s,\"clients\":%u,\"producers\":%u,\"roundtrip_ns\":%lu,"
+        "\"duration_ms\":%lu,\"taken\":%lu,\"returned\":%lu,\"taken_per_sec\":%lu,\"errors\":%lu,\"lost\":%ld}",
+        ok ? "true" : "false", count, config->producers,
+        (unsigned long)(roundtrip_us * 1000 / POOL_BENCH_ROUNDS),
+        (unsigned long)(elapsed / 1000), (unsigned long)taken, (unsigned long)bench->returned.load(),
+        (unsigned long)(elapsed > 0 ? (uint64_t)taken * 1000000 / elapsed : 0),
+        (unsigned long)bench->errors.load(), (long)count - (long)recovered);
+
+    for (uint16_t i = 0; i < count; i++) {
+        delete bench->clients[i];
+    }
+    vQueueDelete(bench->returns);
+    delete[] bench->taken;
+    delete[] bench->clients;
+    delete bench;
+    return out.finish();
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include "AsyncBench.h"
+
+#if CONFIG_ASYNC_TCP_BENCH
+#include "AsyncServer.h"
+#include "bench_peer.h"
+#include "json_writer.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#define TAG "AsyncSoak"
+#define SOAK_TICK_MS        10      // 调度连接、关闭与消息的周期
+#define SOAK_PICK_TRIES     8       // 每次操作最多尝试的对端数
+#define SOAK_WINDOWS        4       // 增长检测将测试时长等分的时间段数
+#define SOAK_COUNT_SLACK    16      // 连接对象数、排队事件数在各时间段间允许的总增长
+#define SOAK_DRAIN_MS       5000    // 关闭所有连接后等待连接与事件回收的最长时间
+#define SOAK_SETTLE_MS      2000    // 释放服务器后等待协议栈释放资源的时间
+
+static const ip_addr_t s_loopback = IPADDR4_INIT_BYTES(127, 0, 0, 1);
+
+/// 单个时间段的采样极值
+struct soak_window_t {
+    uint32_t    samples;
+    uint32_t    min_heap;
+    size_t      max_live;
+    size_t      max_allocated;
+    size_t      max_pending;
+};
+
+/// 按速率累积的操作额度（千分之一次）
+struct soak_rate_t {
+    uint32_t    credit;
+    uint16_t    per_sec;
+
+    /// @brief 累积dt_ms内的额度（最多累积1秒），返回本次可执行的次数
+    uint32_t take(uint32_t dt_ms) {
+        credit = std::min<uint32_t>(credit + per_sec * dt_ms, per_sec * 1000 + 999);
+        auto n = credit / 1000;
+        credit %= 1000;
+        return n;
+    }
+};
+
+static void on_soak_data(void* arg, void* data, size_t len)
+{
+    reinterpret_cast<std::atomic<uint64_t>*>(arg)->fetch_add(len);
+}
+
+/// @brief 各时间段的取值是否逐段增长且总增长超过slack
+template <typename F>
+static bool grows(const soak_window_t* windows, int64_t slack, F value)
+{
+    for (int i = 0; i < SOAK_WINDOWS; i++) {
+        if (windows[i].samples == 0) {
+            return false;
+        }
+        if (i && value(windows[i]) <= value(windows[i - 1])) {
+            return false;
+        }
+    }
+    return value(windows[SOAK_WINDOWS - 1]) - value(windows[0]) > slack;
+}
+
+size_t async_bench_soak(const AsyncBenchSoakConfig* config, char* json, size_t len)
+{
+    AsyncBenchSoakConfig defaults;
+    if (config == nullptr) {
+        config = &defaults;
+    }
+    json_writer_t out(json, len);
+    uint16_t count = config->clients ? config->clients : 1;
+    uint16_t msg_max = config->msg_max ? config->msg_max : 1;
+    uint16_t msg_min = std::min(config->msg_min, msg_max);
+    int64_t duration_us = (config->duration_s ? config->duration_s : 1) * 1000000LL;
+    int64_t sample_us = (config->sample_ms ? config->sample_ms : 1000) * 1000LL;
+
+    auto heap_before = esp_get_free_heap_size();
+    auto* peers = new (std::nothrow) bench_peer_t[count];
+    auto* chunk = new (std::nothrow) uint8_t[msg_max]();
+    auto* server = new (std::nothrow) AsyncServer(s_loopback, config->port);
+    if (peers == nullptr || chunk == nullptr || server == nullptr) {
+        out.append("{\"bench\":\"soak\",\"error\":\"no memory\"}");
+        delete server;
+        delete[] chunk;
+        delete[] peers;
+        return out.finish();
+    }
+
+    std::atomic<uint64_t> received{0};
+    AsyncClientProfile profile;
+    profile.on_data_received_handler = on_soak_data;
+    profile.on_data_received_arg = &received;
+    server->set_client_profile(&profile);
+    server->begin();
+
+    bench_peer_group_t group;
+    group.addr = s_loopback;
+    group.port = config->port;
+    group.chunk = chunk;
+    group.chunk_len = msg_max;
+    group.flood = false;
+    for (uint16_t i = 0; i < count; i++) {
+        peers[i].group = &group;
+    }
+
+    soak_window_t windows[SOAK_WINDOWS] = {};
+    for (auto& w : windows) {
+        w.min_heap = UINT32_MAX;
+    }
+    soak_rate_t connect_rate = { 0, config->connects_per_sec };
+    soak_rate_t close_rate = { 0, config->closes_per_sec };
+    soak_rate_t message_rate = { 0, config->messages_per_sec };
+    uint32_t connects = 0, closes = 0, resets = 0, messages = 0;
+    uint16_t cursor = 0;
+
+    auto start = esp_timer_get_time();
+    auto last_tick = start;
+    auto next_sample = start + sample_us;
+    uint64_t sampled_rx = 0;
+    uint64_t peak_rx_rate = 0;      // 单个采样间隔内的最高接收速率
+    int64_t elapsed = 0;
+    while ((elapsed = esp_timer_get_time() - start) < duration_us) {
+        auto now = start + elapsed;
+        auto dt_ms = (uint32_t)((now - last_tick) / 1000);
+        last_tick += dt_ms * 1000LL;
+
+        // 从游标处依次寻找空闲对端发起连接
+        for (auto n = connect_rate.take(dt_ms); n; n--) {
+            for (int i = 0; i < SOAK_PICK_TRIES; i++) {
+                cursor = (cursor + 1) % count;
+                if (bench_peer_connect(&peers[cursor])) {
+                    connects++;
+                    break;
+                }
+            }
+        }
+        for (auto n = close_rate.take(dt_ms); n; n--) {
+            bool rst = esp_random() % 1000 < config->rst_permille;
+            for (int i = 0; i < SOAK_PICK_TRIES; i++) {
+                if (bench_peer_close(&peers[esp_random() % count], rst)) {
+                    closes++;
+                    resets += rst;
+                    break;
+                }
+            }
+        }
+        for (auto n = message_rate.take(dt_ms); n; n--) {
+            uint16_t size = msg_min + esp_random() % (msg_max - msg_min + 1);
+            for (int i = 0; i < SOAK_PICK_TRIES; i++) {
+                if (bench_peer_send(&peers[esp_random() % count], size)) {
+                    messages++;
+                    break;
+                }
+            }
+        }
+
+        if (now >= next_sample) {
+            auto stats = server->get_stats();
+            uint32_t heap = esp_get_free_heap_size();
+            uint64_t rx = received.load();
+            uint64_t rx_rate = (rx - sampled_rx) * 1000000 / sample_us;
+            peak_rx_rate = std::max(peak_rx_rate, rx_rate);
+            auto& w = windows[std::min<int64_t>(elapsed * SOAK_WINDOWS / duration_us, SOAK_WINDOWS - 1)];
+            w.samples++;
+            w.min_heap = std::min(w.min_heap, heap);
+            w.max_live = std::max(w.max_live, stats.live);
+            w.max_allocated = std::max(w.max_allocated, stats.allocated);
+            w.max_pending = std::max(w.max_pending, stats.pending_events);
+            ESP_LOGI(TAG, "%llus live=%u pooled=%u allocated=%u pending=%u heap=%lu rx=%lluB/s",
+                (unsigned long long)(elapsed / 1000000), (unsigned)stats.live, (unsigned)stats.pooled,
+                (unsigned)stats.allocated, (unsigned)stats.pending_events, (unsigned long)heap,
+                (unsigned long long)rx_rate);
+            sampled_rx = rx;
+            next_sample += sample_us;
+        }
+        vTaskDelay(pdMS_TO_TICKS(SOAK_TICK_MS));
+    }
+    auto peer_stats = bench_peer_stats(&group);
+
+    // 关闭所有连接，等待服务器回收全部连接与事件
+    for (uint16_t i = 0; i < count; i++) {
+        bench_peer_close(&peers[i], false);
+    }
+    auto drain_start = esp_timer_get_time();
+    auto drained = server->get_stats();
+    while ((drained.live || drained.pending_events || drained.allocated != drained.pooled)
+        && esp_timer_get_time() - drain_start < SOAK_DRAIN_MS * 1000LL) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        drained = server->get_stats();
+    }
+    bool released = bench_destroy_server(server);
+    delete[] chunk;
+    delete[] peers;
+    vTaskDelay(pdMS_TO_TICKS(SOAK_SETTLE_MS));
+    auto heap_after = esp_get_free_heap_size();
+
+    bool leak_clients = drained.live || drained.allocated != drained.pooled;
+    bool leak_events = drained.pending_events != 0;
+    bool leak_heap = (int64_t)heap_before - (int64_t)heap_after > (int64_t)config->heap_slack;
+    bool heap_growth = grows(windows, config->heap_slack, [](const soak_window_t& w) {
+            return -(int64_t)w.min_heap;
+        });
+    bool allocated_growth = grows(windows, SOAK_COUNT_SLACK, [](const soak_window_t& w) {
+            return (int64_t)w.max_allocated;
+        });
+    bool pending_growth = grows(windows, SOAK_COUNT_SLACK, [](const soak_window_t& w) {
+            return (int64_t)w.max_pending;
+        });
+    bool ok = released && !leak_clients && !leak_events && !leak_heap && !heap_growth && !allocated_growth && !pending_growth;
+
+    out.append("{\"bench\":\"soak\",\"ok\":%s,\"failures\":[", ok ? "true" : "false");
+    const char* sep = "";
+    const struct {
+        bool        failed;
+        const char* name;
+    } checks[] = {
+        { !released, "server_not_released" },
+        { leak_clients, "client_leak" },
+        { leak_events, "event_leak" },
+        { leak_heap, "heap_leak" },
+        { heap_growth, "heap_growth" },
+        { allocated_growth, "allocated_growth" },
+        { pending_growth, "pending_growth" },
+    };
+    for (auto& check : checks) {
+        if (check.failed) {
+            out.append("%s\"%s\"", sep, check.name);
+            sep = ",";
+        }
+    }
+    out.append("],\"clients\":%u,\"duration_s\":%lu,\"connects\":%lu,\"closes\":%lu,\"resets\":%lu,\"messages\":%lu,"
+        "\"connect_failed\":%lu,\"peer_reset\":%lu,\"rx_bytes\":%llu,\"rx_bytes_per_sec\":%llu,\"peak_rx_bytes_per_sec\":%llu,",
+        count, (unsigned long)(elapsed / 1000000), (unsigned long)connects, (unsigned long)closes,
+        (unsigned long)resets, (unsigned long)messages, (unsigned long)peer_stats.failed,
+        (unsigned long)peer_stats.reset, (unsigned long long)received.load(),
+        elapsed > 0 ? (unsigned long long)(received.load() * 1000000 / elapsed) : 0ULL,
+        (unsigned long long)peak_rx_rate);
+    out.append("\"end\":{\"live\":%u,\"pooled\":%u,\"allocated\":%u,\"pending_events\":%u},"
+        "\"heap_before\":%lu,\"heap_after\":%lu,\"windows\":[",
+        (unsigned)drained.live, (unsigned)drained.pooled, (unsigned)drained.allocated,
+        (unsigned)drained.pending_events, (unsigned long)heap_before, (unsigned long)heap_after);
+    for (int i = 0; i < SOAK_WINDOWS; i++) {
+        auto& w = windows[i];
+        out.append("%s{\"samples\":%lu,\"min_heap\":%lu,\"max_live\":%u,\"max_allocated\":%u,\"max_pending\":%u}",
+            i ? "," : "", (unsigned long)w.samples, (unsigned long)(w.samples ? w.min_heap : 0),
+            (unsigned)w.max_live, (unsigned)w.max_allocated, (unsigned)w.max_pending);
+    }
+    out.append("]}");
+    return out.finish();
+}
+
+#endif
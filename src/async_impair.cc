@@ -0,0 +1,162 @@
+#include "AsyncImpair.h"
+
+#if CONFIG_ASYNC_TCP_IMPAIRMENT
+#include "esp_log.h"
+#include "esp_random.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "my_sysInfo.h"
+#include <new>
+
+#define TAG "AsyncImpair"
+
+/// 延迟发送的报文
+struct impair_packet_t {
+    pbuf*           p;
+    struct netif*   netif;
+    netif_output_fn output;     // 网卡原始的发送函数（停止损伤后仍有效）
+    ip4_addr_t      addr;
+};
+
+struct impair_attach_data_t {
+    tcpip_api_call_data*        data;
+    struct netif*               netif;
+    const AsyncImpairProfile*   profile;
+};
+struct impair_stats_data_t {
+    tcpip_api_call_data*        data;
+    AsyncImpairStats*           stats;
+};
+
+// 以下状态仅在tcpip线程访问
+static struct netif*        s_netif = nullptr;
+static netif_output_fn      s_output = nullptr;     // 网卡原始的发送函数
+static AsyncImpairProfile   s_profile;
+static uint32_t             s_link_free_ms = 0;     // 带宽受限时链路空闲的时间
+static AsyncImpairStats     s_stats;
+
+static bool chance(uint16_t permille)
+{
+    return permille && esp_random() % 1000 < permille;
+}
+
+static void release(void* arg)
+{
+    auto* packet = reinterpret_cast<impair_packet_t*>(arg);
+    packet->output(packet->netif, packet->p, &packet->addr);
+    pbuf_free(packet->p);
+    delete packet;
+}
+
+static err_t impair_output(struct netif* netif, struct pbuf* p, const ip4_addr_t* addr)
+{
+    if (chance(s_profile.loss_permille)) {
+        s_stats.dropped++;
+        return ERR_OK;
+    }
+
+    auto now = SystemInfo::GetMsSinceStart();
+    uint32_t delay = s_profile.delay_ms;
+    // 带宽限制：按报文长度推进链路空闲时间，排队过久时丢弃
+    if (s_profile.rate_bytes_per_sec) {
+        uint32_t start = (int32_t)(s_link_free_ms - now) > 0 ? s_link_free_ms : now;
+        if (start - now > s_profile.queue_ms) {
+            s_stats.overflow++;
+            return ERR_OK;
+        }
+        s_link_free_ms = start + (uint64_t)p->tot_len * 1000 / s_profile.rate_bytes_per_sec;
+        delay += s_link_free_ms - now;
+    }
+    if (s_profile.jitter_ms) {
+        delay += esp_random() % (s_profile.jitter_ms + 1);
+    }
+    if (chance(s_profile.reorder_permille)) {
+        delay += s_profile.reorder_ms;
+        s_stats.reordered++;
+    }
+    if (delay == 0) {
+        s_stats.passed++;
+        return s_output(netif, p, addr);
+    }
+
+    // 调用方会在返回后释放或重发原报文，延迟发送须使用副本
+    auto* packet = new (std::nothrow) impair_packet_t;
+    if (packet == nullptr) {
+        return ERR_MEM;
+    }
+    packet->p = pbuf_clone(PBUF_LINK, PBUF_RAM, p);
+    if (packet->p == nullptr) {
+        delete packet;
+        return ERR_MEM;
+    }
+    packet->netif = netif;
+    packet->output = s_output;
+    packet->addr = *addr;
+    s_stats.delayed++;
+    sys_timeout(delay, release, packet);
+    return ERR_OK;
+}
+
+err_t async_impair_attach(struct netif* netif, const AsyncImpairProfile* profile)
+{
+    if (netif == nullptr || profile == nullptr) {
+        return ERR_ARG;
+    }
+    impair_attach_data_t msg = {
+        .data = nullptr,
+        .netif = netif,
+        .profile = profile
+    };
+    return tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<impair_attach_data_t*>(data);
+            if (s_netif && s_netif != msg->netif) {
+                return ERR_INPROGRESS;
+            }
+            s_profile = *msg->profile;
+            if (s_netif == nullptr) {
+                s_output = msg->netif->output;
+                s_netif = msg->netif;
+                s_netif->output = impair_output;
+                s_link_free_ms = SystemInfo::GetMsSinceStart();
+                s_stats = AsyncImpairStats{};
+            }
+            ESP_LOGI(TAG, "链路损伤：延迟%ums 抖动%ums 丢包%u‰ 乱序%u‰ 带宽%uB/s",
+                (unsigned)s_profile.delay_ms, (unsigned)s_profile.jitter_ms, s_profile.loss_permille,
+                s_profile.reorder_permille, (unsigned)s_profile.rate_bytes_per_sec);
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+}
+
+void async_impair_detach()
+{
+    impair_attach_data_t msg = {};
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            if (s_netif) {
+                s_netif->output = s_output;
+                s_netif = nullptr;
+            }
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+}
+
+AsyncImpairStats async_impair_stats()
+{
+    AsyncImpairStats stats = {};
+    impair_stats_data_t msg = {
+        .data = nullptr,
+        .stats = &stats
+    };
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            *reinterpret_cast<impair_stats_data_t*>(data)->stats = s_stats;
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    return stats;
+}
+
+#endif
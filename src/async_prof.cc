@@ -0,0 +1,129 @@
+#include "AsyncProfile.h"
+#include "json_writer.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+
+#if CONFIG_ASYNC_TCP_PROFILING
+
+struct prof_stat_t {
+    uint32_t    count;
+    uint64_t    cycles;
+    uint32_t    min;
+    uint32_t    max;
+};
+
+static const char* const s_names[] = {
+    "allocate", "recycle", "schedule", "event_run", "add", "send", "write",
+};
+static_assert(sizeof(s_names) / sizeof(s_names[0]) == static_cast<size_t>(AsyncProf::Count), "path names");
+
+static prof_stat_t  s_paths[static_cast<size_t>(AsyncProf::Count)];
+static prof_stat_t  s_chains[ASYNC_PROF_MAX_CHAIN];
+static uint32_t     s_discarded;    // 因任务迁移核心而丢弃的样本数
+static portMUX_TYPE s_prof_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void update(prof_stat_t& stat, uint32_t cycles)
+{
+    taskENTER_CRITICAL(&s_prof_lock);
+    if (stat.count == 0 || cycles < stat.min) {
+        stat.min = cycles;
+    }
+    if (cycles > stat.max) {
+        stat.max = cycles;
+    }
+    stat.count++;
+    stat.cycles += cycles;
+    taskEXIT_CRITICAL(&s_prof_lock);
+}
+
+void async_prof_record(AsyncProf path, uint32_t cycles)
+{
+    update(s_paths[static_cast<size_t>(path)], cycles);
+}
+
+/// @brief 记录一次接收分发，按pbuf链长度分别统计（超过上限的计入最后一项）
+void async_prof_record_chain(size_t segments, uint32_t cycles)
+{
+    if (segments == 0) {
+        return;
+    }
+    if (segments > ASYNC_PROF_MAX_CHAIN) {
+        segments = ASYNC_PROF_MAX_CHAIN;
+    }
+    update(s_chains[segments - 1], cycles);
+}
+
+/// @brief 记录一个因任务迁移核心而丢弃的样本
+void async_prof_discard()
+{
+    taskENTER_CRITICAL(&s_prof_lock);
+    s_discarded++;
+    taskEXIT_CRITICAL(&s_prof_lock);
+}
+
+static void append(json_writer_t& json, const char* name, const prof_stat_t& stat, bool first)
+{
+    json.append("%s\"%s\":{\"count\":%lu,\"avg_cycles\":%lu,\"min_cycles\":%lu,\"max_cycles\":%lu}",
+        first ? "" : ",", name,
+        (unsigned long)stat.count,
+        (unsigned long)(stat.count ? stat.cycles / stat.count : 0),
+        (unsigned long)stat.min,
+        (unsigned long)stat.max);
+}
+
+size_t async_prof_dump_json(char* buf, size_t len)
+{
+    prof_stat_t paths[static_cast<size_t>(AsyncProf::Count)];
+    prof_stat_t chains[ASYNC_PROF_MAX_CHAIN];
+    taskENTER_CRITICAL(&s_prof_lock);
+    for (size_t i = 0; i < static_cast<size_t>(AsyncProf::Count); i++) {
+        paths[i] = s_paths[i];
+    }
+    for (size_t i = 0; i < ASYNC_PROF_MAX_CHAIN; i++) {
+        chains[i] = s_chains[i];
+    }
+    auto discarded = s_discarded;
+    taskEXIT_CRITICAL(&s_prof_lock);
+
+    json_writer_t json(buf, len);
+    json.append("{\"paths\":{");
+    for (size_t i = 0; i < static_cast<size_t>(AsyncProf::Count); i++) {
+        append(json, s_names[i], paths[i], i == 0);
+    }
+    json.append("},\"recv_chain\":{");
+    char name[8];
+    for (size_t i = 0; i < ASYNC_PROF_MAX_CHAIN; i++) {
+        snprintf(name, sizeof(name), "%u", (unsigned)(i + 1));
+        append(json, name, chains[i], i == 0);
+    }
+    json.append("},\"discarded\":%lu}", (unsigned long)discarded);
+    return json.finish();
+}
+
+void async_prof_reset()
+{
+    taskENTER_CRITICAL(&s_prof_lock);
+    for (auto& stat : s_paths) {
+        stat = prof_stat_t{};
+    }
+    for (auto& stat : s_chains) {
+        stat = prof_stat_t{};
+    }
+    s_discarded = 0;
+    taskEXIT_CRITICAL(&s_prof_lock);
+}
+
+#else
+
+size_t async_prof_dump_json(char* buf, size_t len)
+{
+    json_writer_t json(buf, len);
+    json.append("{}");
+    return json.finish();
+}
+
+void async_prof_reset()
+{
+}
+
+#endif
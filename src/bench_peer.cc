@@ -0,0 +1,220 @@
+#include "bench_peer.h"
+
+#if CONFIG_ASYNC_TCP_BENCH
+#include "esp_timer.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+
+struct peer_call_data_t {
+    tcpip_api_call_data*    data;
+    bench_peer_t*           peer;
+    bool                    rst;
+    uint16_t                len;
+};
+struct peer_stats_data_t {
+    tcpip_api_call_data*    data;
+    bench_peer_group_t*     group;
+    bench_peer_stats_t*     stats;
+};
+
+/// @brief 注销回调并关闭连接（仅在tcpip线程中调用）
+/// @return 连接被强制断开时返回true，在lwIP回调中调用时须返回ERR_ABRT
+static bool detach(bench_peer_t* peer, bool rst)
+{
+    auto* pcb = peer->pcb;
+    peer->pcb = nullptr;
+    peer->group->stats.open--;
+    tcp_arg(pcb, nullptr);
+    tcp_recv(pcb, nullptr);
+    tcp_sent(pcb, nullptr);
+    tcp_err(pcb, nullptr);
+    if (rst || tcp_close(pcb) != ERR_OK) {
+        tcp_abort(pcb);
+        return true;
+    }
+    return false;
+}
+
+/// @brief 写满发送缓冲区（仅在tcpip线程中调用）
+static void pump(bench_peer_t* peer)
+{
+    auto* group = peer->group;
+    if (group->chunk == nullptr || !group->flood) {
+        return;
+    }
+    bool queued = false;
+    while (tcp_sndbuf(peer->pcb) >= group->chunk_len) {
+        if (tcp_write(peer->pcb, group->chunk, group->chunk_len, 0) != ERR_OK) {
+            break;
+        }
+        group->stats.tx_bytes += group->chunk_len;
+        queued = true;
+    }
+    if (queued) {
+        tcp_output(peer->pcb);
+    }
+}
+
+static err_t on_connected(void* arg, tcp_pcb* pcb, err_t err)
+{
+    auto* peer = reinterpret_cast<bench_peer_t*>(arg);
+    auto* group = peer->group;
+    peer->established = true;
+    group->stats.connected++;
+    if (group->on_connected && !group->on_connected(peer, group->on_connected_arg)) {
+        return detach(peer, false) ? ERR_ABRT : ERR_OK;
+    }
+    pump(peer);
+    return ERR_OK;
+}
+
+static err_t on_received(void* arg, tcp_pcb* pcb, pbuf* pb, err_t err)
+{
+    auto* peer = reinterpret_cast<bench_peer_t*>(arg);
+    if (pb == nullptr) {
+        // 对端关闭
+        return detach(peer, false) ? ERR_ABRT : ERR_OK;
+    }
+    auto* group = peer->group;
+    group->stats.rx_bytes += pb->tot_len;
+    if (group->on_received) {
+        group->on_received(peer, pb->tot_len, group->on_received_arg);
+    }
+    tcp_recved(pcb, pb->tot_len);
+    pbuf_free(pb);
+    return ERR_OK;
+}
+
+static err_t on_sent(void* arg, tcp_pcb* pcb, uint16_t len)
+{
+    pump(reinterpret_cast<bench_peer_t*>(arg));
+    return ERR_OK;
+}
+
+static void on_error(void* arg, err_t err)
+{
+    auto* peer = reinterpret_cast<bench_peer_t*>(arg);
+    auto& stats = peer->group->stats;
+    peer->pcb = nullptr;        // 协议栈已释放
+    stats.open--;
+    if (peer->established) {
+        stats.reset++;
+    } else {
+        stats.failed++;
+    }
+}
+
+/// @brief 向对端组的目标地址发起连接
+/// @return 对端已有连接或无法发起连接时返回false
+bool bench_peer_connect(bench_peer_t* peer)
+{
+    peer_call_data_t msg = {
+        .data = nullptr,
+        .peer = peer,
+        .rst = false,
+        .len = 0
+    };
+    return tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* peer = reinterpret_cast<peer_call_data_t*>(data)->peer;
+            auto& stats = peer->group->stats;
+            if (peer->pcb) {
+                return ERR_ISCONN;
+            }
+            auto* pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+            if (pcb == nullptr) {
+                stats.failed++;
+                return ERR_MEM;
+            }
+            tcp_arg(pcb, peer);
+            peer->established = false;
+            peer->start_us = esp_timer_get_time();
+            auto err = tcp_connect(pcb, &peer->group->addr, peer->group->port, on_connected);
+            if (err != ERR_OK) {
+                tcp_abort(pcb);
+                stats.failed++;
+                return err;
+            }
+            tcp_recv(pcb, on_received);
+            tcp_sent(pcb, on_sent);
+            tcp_err(pcb, on_error);
+            peer->pcb = pcb;
+            stats.open++;
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg) == ERR_OK;
+}
+
+/// @brief 关闭对端连接，对端空闲时不做任何事
+/// @param rst true时强制断开（RST），false时发送FIN
+/// @return 对端空闲时返回false
+bool bench_peer_close(bench_peer_t* peer, bool rst)
+{
+    peer_call_data_t msg = {
+        .data = nullptr,
+        .peer = peer,
+        .rst = rst,
+        .len = 0
+    };
+    return tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<peer_call_data_t*>(data);
+            if (msg->peer->pcb == nullptr) {
+                return ERR_CONN;
+            }
+            detach(msg->peer, msg->rst);
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg) == ERR_OK;
+}
+
+/// @brief 发送一条消息（对端组发送数据的前len字节）
+/// @return 连接未建立或发送缓冲区不足时返回false
+bool bench_peer_send(bench_peer_t* peer, uint16_t len)
+{
+    if (len > peer->group->chunk_len) {
+        len = peer->group->chunk_len;
+    }
+    peer_call_data_t msg = {
+        .data = nullptr,
+        .peer = peer,
+        .rst = false,
+        .len = len
+    };
+    return tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<peer_call_data_t*>(data);
+            auto* peer = msg->peer;
+            if (peer->pcb == nullptr || !peer->established) {
+                return ERR_CONN;
+            }
+            if (tcp_sndbuf(peer->pcb) < msg->len) {
+                return ERR_MEM;
+            }
+            auto err = tcp_write(peer->pcb, peer->group->chunk, msg->len, 0);
+            if (err != ERR_OK) {
+                return err;
+            }
+            peer->group->stats.tx_bytes += msg->len;
+            tcp_output(peer->pcb);
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg) == ERR_OK;
+}
+
+/// @brief 获取对端组统计
+bench_peer_stats_t bench_peer_stats(bench_peer_group_t* group)
+{
+    bench_peer_stats_t stats = {};
+    peer_stats_data_t msg = {
+        .data = nullptr,
+        .group = group,
+        .stats = &stats
+    };
+    tcpip_api_call([](tcpip_api_call_data* data) -> err_t {
+            auto* msg = reinterpret_cast<peer_stats_data_t*>(data);
+            *msg->stats = msg->group->stats;
+            return ERR_OK;
+        },
+        (tcpip_api_call_data*)&msg);
+    return stats;
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef BENCH_PEER_H_
+#define BENCH_PEER_H_
+
+#include "sdkconfig.h"
+
+#if CONFIG_ASYNC_TCP_BENCH
+#include "json_writer.h"
+#include "lwip/tcp.h"
+
+// 基准测试使用的回环对端：直接使用lwIP原始接口，不经过AsyncClient，
+// 对端自身只增加协议栈的开销，测得的延迟与吞吐量反映被测服务器的表现。
+
+class AsyncServer;
+struct bench_peer_t;
+using bench_peer_fn = bool (*)(bench_peer_t* peer, void* arg);
+using bench_peer_rx_fn = void (*)(bench_peer_t* peer, size_t len, void* arg);
+
+/// 对端统计
+struct bench_peer_stats_t {
+    uint32_t    connected;  // 累计建立的连接数
+    uint32_t    failed;     // 未能建立的连接数
+    uint32_t    reset;      // 建立后被对端或协议栈中断的连接数
+    uint32_t    open;       // 当前占用pcb的连接数（连接中 + 已建立）
+    uint64_t    tx_bytes;   // 累计写入协议栈的字节数
+    uint64_t    rx_bytes;   // 累计接收的字节数
+};
+
+/// 对端组：同一组对端共享目标地址、发送数据、回调与统计
+struct bench_peer_group_t {
+    ip_addr_t           addr;
+    uint16_t            port{0};
+    const uint8_t*      chunk{nullptr};         // 发送的数据（不复制，须在组存续期间有效）
+    uint16_t            chunk_len{0};           //
+    bool                flood{true};            // 连接建立后持续写满发送缓冲区；false时只通过bench_peer_send()发送
+    bench_peer_fn       on_connected{nullptr};  // 连接建立回调（tcpip线程），返回false时立即关闭连接
+    void*               on_connected_arg{nullptr};
+    bench_peer_rx_fn    on_received{nullptr};   // 收到数据回调（tcpip线程）
+    void*               on_received_arg{nullptr};
+    bench_peer_stats_t  stats{};                // 统计（仅在tcpip线程修改，通过bench_peer_stats()读取）
+};
+
+/// 单个对端连接（以下字段仅在tcpip线程修改）
+struct bench_peer_t {
+    bench_peer_group_t* group{nullptr};
+    tcp_pcb*            pcb{nullptr};           // 为空时表示空闲，可再次连接
+    int64_t             start_us{0};            // 发起连接的时间
+    bool                established{false};
+};
+
+extern bool bench_peer_connect(bench_peer_t* peer);
+extern bool bench_peer_close(bench_peer_t* peer, bool rst);
+extern bool bench_peer_send(bench_peer_t* peer, uint16_t len);
+extern bench_peer_stats_t bench_peer_stats(bench_peer_group_t* group);
+
+/// 延迟分布（微秒）
+struct bench_latency_t {
+    uint32_t    count;
+    uint32_t    failed;     // 未能建立或等待超时的次数
+    uint32_t    min;
+    uint32_t    p50;
+    uint32_t    p90;
+    uint32_t    p99;
+    uint32_t    max;
+};
+
+extern bool bench_destroy_server(AsyncServer* server);
+extern bench_latency_t bench_summarize(uint32_t* samples, size_t count, uint32_t failed);
+extern void bench_append_latency(json_writer_t& json, const char* name, const bench_latency_t& latency);
+
+#endif
+
+#endif
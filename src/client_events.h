@@ -0,0 +1,76 @@
+#ifndef CLIENT_EVENTS_H_
+#define CLIENT_EVENTS_H_
+
+// 运行时回调策略，事件路径的模板实现见 detail/client_events.h。
+
+#include "detail/client_events.h"
+
+/// 运行时回调策略：通过回调表（AsyncClientProfile）中的函数指针分发事件
+struct AsyncClient::ProfilePolicy {
+    static constexpr bool has_connected     = true;
+    static constexpr bool has_disconnected  = true;
+    static constexpr bool has_sent          = true;
+    static constexpr bool has_error         = true;
+    static constexpr bool has_data          = true;
+    static constexpr bool has_poll          = true;
+    static constexpr bool has_timeout       = true;
+    static constexpr bool has_recycle       = true;
+
+    static void on_connected(AsyncClient* c) {
+        auto* profile = c->profile_;
+        if (profile->on_connected_handler) {
+            profile->on_connected_handler(profile->on_connected_arg, c);
+        }
+    }
+    static void on_disconnected(AsyncClient* c) {
+        auto* profile = c->profile_;
+        if (profile->on_disconnected_handler) {
+            profile->on_disconnected_handler(profile->on_disconnected_arg);
+        }
+    }
+    static void on_sent(AsyncClient* c, size_t len, uint32_t time) {
+        auto* profile = c->profile_;
+        if (profile->on_data_sent_handler) {
+            profile->on_data_sent_handler(profile->on_data_sent_arg, len, time);
+        }
+    }
+    static void on_error(AsyncClient* c, err_t err) {
+        auto* profile = c->profile_;
+        if (profile->on_error_handler) {
+            profile->on_error_handler(profile->on_error_arg, err);
+        }
+    }
+    static void on_data(AsyncClient* c, pbuf* pb) {
+        auto* profile = c->profile_;
+        if (profile->on_data_received_handler != nullptr) {
+            while (pb) {
+                auto* current = pb;
+                pb = pb->next;
+                profile->on_data_received_handler(profile->on_data_received_arg, current->payload, current->len);
+            }
+        }
+    }
+    static void on_poll(AsyncClient* c) {
+        auto* profile = c->profile_;
+        if (profile->on_poll_handler) {
+            profile->on_poll_handler(profile->on_poll_arg);
+        }
+    }
+    /// @return 未设置超时回调时返回false，由调用方执行默认处理
+    static bool on_timeout(AsyncClient* c, uint32_t time) {
+        auto* profile = c->profile_;
+        if (profile->on_timeout_handler) {
+            profile->on_timeout_handler(profile->on_timeout_arg, time);
+            return true;
+        }
+        return false;
+    }
+    static void on_recycle(AsyncClient* c) {
+        auto* profile = c->profile_;
+        if (profile->on_recycle_handler) {
+            profile->on_recycle_handler(profile->on_recycle_arg);
+        }
+    }
+};
+
+#endif
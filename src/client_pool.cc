@@ -0,0 +1,114 @@
+#include "client_pool.h"
+#include "AsyncClient.h"
+
+AsyncClientPool::AsyncClientPool()
+{
+    for (auto& mag : magazines_) {
+        spinlock_initialize(&mag.lock);
+        mag.count = 0;
+        mag.pushed = 0;
+    }
+}
+
+/// @brief 获取池中空闲连接数（用于统计，与并发的放回、取出之间可能相差几个）
+size_t AsyncClientPool::size()
+{
+    size_t pushed = 0;
+    for (auto& mag : magazines_) {
+        taskENTER_CRITICAL(&mag.lock);
+        pushed += mag.pushed;
+        taskEXIT_CRITICAL(&mag.lock);
+    }
+    auto popped = popped_.load();
+    return pushed > popped ? pushed - popped : 0;
+}
+
+/// @brief 取出一个空闲连接，优先使用当前核心的缓存（仅在tcpip线程中调用）
+/// @return 连接池为空时返回nullptr
+AsyncClient* AsyncClientPool::pop()
+{
+    auto core = xPortGetCoreID();
+    auto* client = pop_magazine(magazines_[core]);
+    if (client == nullptr) {
+        client = pop_shared();
+    }
+    // 共享栈为空时从其他核心的缓存中获取
+    for (int i = 0; client == nullptr && i < portNUM_PROCESSORS; i++) {
+        if (i != core) {
+            client = pop_magazine(magazines_[i]);
+        }
+    }
+    if (client) {
+        popped_.store(popped_.load(std::memory_order_relaxed) + 1);
+    }
+    return client;
+}
+
+/// @brief 放回一个空闲连接，当前核心缓存已满时放入共享栈
+void AsyncClientPool::push(AsyncClient* client)
+{
+    auto& mag = magazines_[xPortGetCoreID()];
+    taskENTER_CRITICAL(&mag.lock);
+    mag.pushed++;
+    if (mag.count < CLIENT_POOL_MAGAZINE_SIZE) {
+        mag.slots[mag.count++] = client;
+        taskEXIT_CRITICAL(&mag.lock);
+        return;
+    }
+    taskEXIT_CRITICAL(&mag.lock);
+    push_shared(client);
+}
+
+/// @brief 取出所有空闲连接（仅在tcpip线程中调用）
+/// @return 以next_串联的连接链表
+AsyncClient* AsyncClientPool::take_all()
+{
+    auto* list = head_.exchange(nullptr);
+    for (auto& mag : magazines_) {
+        AsyncClient* client;
+        while ((client = pop_magazine(mag)) != nullptr) {
+            client->next_ = list;
+            list = client;
+        }
+    }
+    size_t count = 0;
+    for (auto* c = list; c; c = c->next_) {
+        count++;
+    }
+    popped_.store(popped_.load(std::memory_order_relaxed) + count);
+    return list;
+}
+
+/// @brief 获取take_all()返回的链表中的下一个连接
+AsyncClient* AsyncClientPool::next(AsyncClient* client)
+{
+    return client->next_;
+}
+
+/// @brief 从共享栈取出一个连接（单消费者：只有本线程会取出，栈顶的next_在比较交换前不会改变）
+AsyncClient* AsyncClientPool::pop_shared()
+{
+    auto* expected = head_.load();
+    while (expected && !head_.compare_exchange_weak(expected, expected->next_)) {
+    }
+    return expected;
+}
+
+void AsyncClientPool::push_shared(AsyncClient* client)
+{
+    auto* expected = head_.load();
+    do {
+        client->next_ = expected;
+    } while (!head_.compare_exchange_weak(expected, client));
+}
+
+AsyncClient* AsyncClientPool::pop_magazine(magazine_t& mag)
+{
+    AsyncClient* client = nullptr;
+    taskENTER_CRITICAL(&mag.lock);
+    if (mag.count) {
+        client = mag.slots[--mag.count];
+    }
+    taskEXIT_CRITICAL(&mag.lock);
+    return client;
+}
@@ -0,0 +1,48 @@
+#ifndef CLIENT_POOL_H_
+#define CLIENT_POOL_H_
+
+#include "freertos/FreeRTOS.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CLIENT_POOL_MAGAZINE_SIZE   4       // 每个核心缓存的连接数
+
+class AsyncClient;
+
+/// @brief 空闲连接池：单消费者无锁栈 + 每核心小缓存。
+/// 取出（pop/take_all）只在tcpip线程中进行，放回（push）可在任意任务中进行。
+/// 栈顶只有一个消费者，取出时读取的next_不会被其他任务改动，无ABA问题，因此栈顶只需一个指针宽度的原子量
+/// （32位目标上带版本号的双字原子量不是无锁的）。
+/// 核心缓存由portMUX自旋锁保护，临界区只有几条指令；缓存命中时不访问共享的栈顶。
+/// 空闲连接数由各核心的放回计数与消费者的取出计数相减得到，放回与取出时都不修改共享计数。
+class AsyncClientPool {
+public:
+    AsyncClientPool();
+
+    AsyncClient* pop();
+    void push(AsyncClient* client);
+    AsyncClient* take_all();
+    static AsyncClient* next(AsyncClient* client);
+    size_t size();
+
+private:
+    struct magazine_t {
+        portMUX_TYPE    lock;
+        uint8_t         count;
+        size_t          pushed;     // 经本核心放回的累计连接数（含溢出到共享栈的）
+        AsyncClient*    slots[CLIENT_POOL_MAGAZINE_SIZE];
+    };
+
+    AsyncClient* pop_shared();
+    void push_shared(AsyncClient* client);
+    AsyncClient* pop_magazine(magazine_t& mag);
+
+    static_assert(std::atomic<AsyncClient*>::is_always_lock_free, "连接池栈顶须为无锁原子量");
+
+    std::atomic<AsyncClient*>   head_{nullptr};
+    std::atomic<size_t>         popped_{0};     // 累计取出的连接数（只由tcpip线程写入，不使用读-改-写）
+    magazine_t                  magazines_[portNUM_PROCESSORS];
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef JSON_WRITER_H_
+#define JSON_WRITER_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/// 向固定长度的缓冲区输出JSON：始终累计完整输出所需的长度，缓冲区不足时不留下不完整的JSON
+struct json_writer_t {
+    char*   buf;
+    size_t  len;
+    size_t  pos{0};     // 完整输出所需的字节数（不含结尾0）
+
+    json_writer_t(char* buf, size_t len) : buf(buf), len(buf ? len : 0) {}
+
+    void append(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        auto n = vsnprintf(pos < len ? buf + pos : nullptr, pos < len ? len - pos : 0, fmt, args);
+        va_end(args);
+        if (n > 0) {
+            pos += n;
+        }
+    }
+
+    /// @return 完整输出所需的字节数（不含结尾0），不小于缓冲区长度时缓冲区内为空字符串
+    size_t finish() {
+        if (pos >= len && len) {
+            buf[0] = '\0';
+        }
+        return pos;
+    }
+};
+
+#endif
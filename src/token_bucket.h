@@ -0,0 +1,65 @@
+#ifndef TOKEN_BUCKET_H_
+#define TOKEN_BUCKET_H_
+
+#include <stdint.h>
+
+/// 发送限速令牌桶（非线程安全，仅在tcpip线程中修改）
+struct token_bucket_t {
+    uint32_t    rate{0};        // 每秒补充的字节数，0表示不限速
+    uint32_t    burst{0};       // 令牌上限（允许的突发字节数）
+    uint32_t    tokens{0};      // 当前可用令牌
+    uint32_t    last_ms{0};     // 上次补充时间
+
+    /// @brief 设置速率，令牌桶重新装满
+    void set(uint32_t bytes_per_sec, uint32_t burst_bytes, uint32_t now) {
+        rate = bytes_per_sec;
+        burst = burst_bytes;
+        tokens = burst_bytes;
+        last_ms = now;
+    }
+
+    /// @brief 计算当前可用令牌但不修改状态（可在其他任务中粗略读取）
+    uint32_t peek(uint32_t now) const {
+        if (rate == 0) {
+            return UINT32_MAX;
+        }
+        uint64_t total = tokens + (uint64_t)(now - last_ms) * rate / 1000;
+        return total >= burst ? burst : (uint32_t)total;
+    }
+
+    /// @brief 补充令牌并返回可用令牌数，不限速时返回UINT32_MAX
+    uint32_t refill(uint32_t now) {
+        if (rate == 0) {
+            return UINT32_MAX;
+        }
+        uint64_t gained = (uint64_t)(now - last_ms) * rate / 1000;
+        if (tokens + gained >= burst) {
+            tokens = burst;
+            last_ms = now;
+        } else if (gained) {
+            // 只推进已兑现部分对应的时间，低速率下不丢失零头
+            tokens += gained;
+            last_ms += gained * 1000 / rate;
+        }
+        return tokens;
+    }
+
+    void consume(uint32_t n) {
+        if (rate) {
+            tokens = n > tokens ? 0 : tokens - n;
+        }
+    }
+
+    /// @brief 令牌积累到need所需的等待时间（毫秒）
+    uint32_t wait_ms(uint32_t need) const {
+        if (need > burst) {
+            need = burst;
+        }
+        if (rate == 0 || tokens >= need) {
+            return 0;
+        }
+        return ((uint64_t)(need - tokens) * 1000 + rate - 1) / rate;
+    }
+};
+
+#endif